@@ -0,0 +1,290 @@
+#ifndef BPLUSTREE_H
+#define BPLUSTREE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include "KeySearch.h"
+
+using namespace std;
+
+
+// BPlusTree
+// int set with the Insert/TryInsert/Contains/GetMin/GetMax/Size interface
+// of RedBlackTree, stored as a B+ tree whose nodes are exactly NodeBytes
+// (64 or 128) long. A red-black tree is a binary encoding of a 2-3-4 tree;
+// widening the nodes to a cache line or two puts 7 to 30 keys behind each
+// miss, so a lookup costs about log_8(n) to log_16(n) misses instead of
+// log_2(n). Each node is scanned by CountLessInt32, which counts the keys
+// below the probe with SIMD compares and no branch. Nodes live in two index-addressed arrays like
+// CompactRedBlackTree; keys can only be added.
+template <size_t NodeBytes = 128>
+class BPlusTree {
+
+	public:
+		static_assert(NodeBytes == 64 || NodeBytes == 128, "Nodes are one or two cache lines");
+		static const uint32_t NIL = 0xFFFFFFFF;
+
+		BPlusTree() = default;
+
+		void Insert(int newData);
+		bool TryInsert(int newData);
+
+		bool Contains(int data) const;
+		size_t Size() const { return numItems; };
+		int GetMin() const;
+		int GetMax() const;
+
+		template <class Visitor>
+		void ForEach(Visitor visit) const;
+
+	private:
+		static constexpr size_t LANES = NodeBytes / sizeof(int32_t);
+		static constexpr uint32_t LEAF_KEYS = LANES - 2;
+		static constexpr uint32_t INNER_KEYS = LANES / 2 - 1;
+
+		// The count follows the keys so one scan of the whole leaf, or of the
+		// first half of an inner node, covers every key; lanes past count are
+		// masked off.
+		struct alignas(NodeBytes) Leaf {
+			int32_t keys[LEAF_KEYS];
+			uint32_t count;
+			uint32_t next;   // leaf holding the following keys, or NIL
+		};
+
+		// Every key of children[i] is <= keys[i] < every key of children[i + 1].
+		struct alignas(NodeBytes) Inner {
+			int32_t keys[INNER_KEYS];
+			uint32_t count;
+			uint32_t children[INNER_KEYS + 1];
+		};
+
+		static_assert(sizeof(Leaf) == NodeBytes && sizeof(Inner) == NodeBytes, "Nodes must fill NodeBytes exactly");
+
+		// One step of an insert's descent: the inner node and the child taken.
+		struct PathStep {
+			uint32_t node;
+			uint32_t child;
+		};
+
+		vector<Leaf> leaves;
+		vector<Inner> inners;
+		uint32_t root = NIL;
+		int height = 0;   // inner levels above the leaves
+		uint32_t lastLeaf = NIL;
+		size_t numItems = 0;
+
+		uint32_t NewLeaf();
+		uint32_t NewInner();
+		uint32_t SplitLeaf(uint32_t leaf, uint32_t pos, int key, int &separator);
+		void InsertSeparator(const PathStep *path, int depth, int separator, uint32_t right);
+};
+
+
+#define BPT_TEMPLATE template <size_t NodeBytes>
+#define BPT_CLASS BPlusTree<NodeBytes>
+
+// Insert
+// Adds a new key, throwing invalid_argument if it is already present.
+BPT_TEMPLATE
+void BPT_CLASS::Insert(int newData) {
+    if (!TryInsert(newData)) {
+        throw invalid_argument("Duplicate entry not allowed.");
+    }
+}
+
+// TryInsert
+// Same as Insert, but reports a duplicate by returning false instead of throwing.
+// A full leaf is split in two and the split carried up the path, growing a
+// new root when the old one splits.
+BPT_TEMPLATE
+bool BPT_CLASS::TryInsert(int newData) {
+    if (root == NIL) {
+        root = lastLeaf = NewLeaf();
+        height = 0;
+    }
+
+    PathStep path[64];
+    uint32_t n = root;
+    for (int depth = 0; depth < height; depth++) {
+        const Inner &inner = inners[n];
+        uint32_t child = CountLessInt32<INNER_KEYS + 1>(inner.keys, inner.count, newData);
+        path[depth] = PathStep{n, child};
+        n = inner.children[child];
+    }
+
+    Leaf &leaf = leaves[n];
+    uint32_t pos = CountLessInt32<LANES>(leaf.keys, leaf.count, newData);
+    if (pos < leaf.count && leaf.keys[pos] == newData) {
+        return false;
+    }
+    if (leaf.count < LEAF_KEYS) {
+        memmove(leaf.keys + pos + 1, leaf.keys + pos, (leaf.count - pos) * sizeof(int32_t));
+        leaf.keys[pos] = newData;
+        leaf.count++;
+    } else {
+        int separator;
+        uint32_t right = SplitLeaf(n, pos, newData, separator);
+        InsertSeparator(path, height, separator, right);
+    }
+    numItems++;
+    return true;
+}
+
+// Contains
+// Returns true if the tree contains the key: one masked scan per level.
+BPT_TEMPLATE
+bool BPT_CLASS::Contains(int data) const {
+    if (root == NIL) return false;
+    uint32_t n = root;
+    for (int depth = 0; depth < height; depth++) {
+        const Inner &inner = inners[n];
+        n = inner.children[CountLessInt32<INNER_KEYS + 1>(inner.keys, inner.count, data)];
+    }
+    const Leaf &leaf = leaves[n];
+    uint32_t pos = CountLessInt32<LANES>(leaf.keys, leaf.count, data);
+    return pos < leaf.count && leaf.keys[pos] == data;
+}
+
+// GetMin
+// Returns the smallest key, which heads the first leaf since leaves only
+// ever split to the right.
+BPT_TEMPLATE
+int BPT_CLASS::GetMin() const {
+    if (numItems == 0) throw underflow_error("Tree is empty.");
+    return leaves[0].keys[0];
+}
+
+// GetMax
+// Returns the largest key, the end of the last leaf.
+BPT_TEMPLATE
+int BPT_CLASS::GetMax() const {
+    if (numItems == 0) throw underflow_error("Tree is empty.");
+    const Leaf &leaf = leaves[lastLeaf];
+    return leaf.keys[leaf.count - 1];
+}
+
+// ForEach
+// Calls visit(key) in key order by following the leaf chain.
+BPT_TEMPLATE
+template <class Visitor>
+void BPT_CLASS::ForEach(Visitor visit) const {
+    if (root == NIL) return;
+    for (uint32_t n = 0; n != NIL; n = leaves[n].next) {
+        const Leaf &leaf = leaves[n];
+        for (uint32_t i = 0; i < leaf.count; i++) {
+            visit(leaf.keys[i]);
+        }
+    }
+}
+
+// NewLeaf
+// Appends an empty leaf and returns its index.
+BPT_TEMPLATE
+uint32_t BPT_CLASS::NewLeaf() {
+    if (leaves.size() >= NIL) {
+        throw length_error("B+ tree is full.");
+    }
+    leaves.emplace_back();
+    leaves.back().count = 0;
+    leaves.back().next = NIL;
+    return static_cast<uint32_t>(leaves.size() - 1);
+}
+
+// NewInner
+// Appends an empty inner node and returns its index.
+BPT_TEMPLATE
+uint32_t BPT_CLASS::NewInner() {
+    if (inners.size() >= NIL) {
+        throw length_error("B+ tree is full.");
+    }
+    inners.emplace_back();
+    inners.back().count = 0;
+    return static_cast<uint32_t>(inners.size() - 1);
+}
+
+// SplitLeaf
+// Inserts key at pos into the full leaf by moving the upper half of its
+// keys into a new leaf linked in after it. Returns the new leaf and sets
+// separator to the largest key left behind.
+BPT_TEMPLATE
+uint32_t BPT_CLASS::SplitLeaf(uint32_t leaf, uint32_t pos, int key, int &separator) {
+    int32_t keys[LEAF_KEYS + 1];
+    memcpy(keys, leaves[leaf].keys, pos * sizeof(int32_t));
+    keys[pos] = key;
+    memcpy(keys + pos + 1, leaves[leaf].keys + pos, (LEAF_KEYS - pos) * sizeof(int32_t));
+
+    uint32_t right = NewLeaf();
+    Leaf &left = leaves[leaf];
+    Leaf &split = leaves[right];
+    uint32_t half = (LEAF_KEYS + 1) / 2;
+    memcpy(left.keys, keys, half * sizeof(int32_t));
+    memcpy(split.keys, keys + half, (LEAF_KEYS + 1 - half) * sizeof(int32_t));
+    left.count = half;
+    split.count = LEAF_KEYS + 1 - half;
+    split.next = left.next;
+    left.next = right;
+    if (lastLeaf == leaf) lastLeaf = right;
+    separator = left.keys[half - 1];
+    return right;
+}
+
+// InsertSeparator
+// Hangs right after the child taken at path[depth - 1], with separator
+// between them. A full inner node splits around its middle key, which moves
+// up to the next level in turn; past the root a new root is made.
+BPT_TEMPLATE
+void BPT_CLASS::InsertSeparator(const PathStep *path, int depth, int separator, uint32_t right) {
+    while (depth > 0) {
+        depth--;
+        uint32_t n = path[depth].node;
+        uint32_t pos = path[depth].child;
+        Inner &inner = inners[n];
+        if (inner.count < INNER_KEYS) {
+            memmove(inner.keys + pos + 1, inner.keys + pos, (inner.count - pos) * sizeof(int32_t));
+            memmove(inner.children + pos + 2, inner.children + pos + 1, (inner.count - pos) * sizeof(uint32_t));
+            inner.keys[pos] = separator;
+            inner.children[pos + 1] = right;
+            inner.count++;
+            return;
+        }
+
+        int32_t keys[INNER_KEYS + 1];
+        uint32_t children[INNER_KEYS + 2];
+        memcpy(keys, inner.keys, pos * sizeof(int32_t));
+        keys[pos] = separator;
+        memcpy(keys + pos + 1, inner.keys + pos, (INNER_KEYS - pos) * sizeof(int32_t));
+        memcpy(children, inner.children, (pos + 1) * sizeof(uint32_t));
+        children[pos + 1] = right;
+        memcpy(children + pos + 2, inner.children + pos + 1, (INNER_KEYS - pos) * sizeof(uint32_t));
+
+        uint32_t sibling = NewInner();
+        Inner &left = inners[n];
+        Inner &split = inners[sibling];
+        uint32_t half = (INNER_KEYS + 1) / 2;
+        memcpy(left.keys, keys, half * sizeof(int32_t));
+        memcpy(left.children, children, (half + 1) * sizeof(uint32_t));
+        left.count = half;
+        memcpy(split.keys, keys + half + 1, (INNER_KEYS - half) * sizeof(int32_t));
+        memcpy(split.children, children + half + 1, (INNER_KEYS + 1 - half) * sizeof(uint32_t));
+        split.count = INNER_KEYS - half;
+        separator = keys[half];
+        right = sibling;
+    }
+
+    uint32_t newRoot = NewInner();
+    Inner &top = inners[newRoot];
+    top.keys[0] = separator;
+    top.children[0] = root;
+    top.children[1] = right;
+    top.count = 1;
+    root = newRoot;
+    height++;
+}
+
+#undef BPT_CLASS
+#undef BPT_TEMPLATE
+
+#endif
@@ -0,0 +1,87 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "RedBlackTree.h"
+#include "CompactRedBlackTree.h"
+#include "BPlusTree.h"
+#include "BucketedRedBlackTree.h"
+
+/**
+ *
+ * Compares the B+ tree engine, with 64 and 128 byte nodes, against
+ * RedBlackTree, CompactRedBlackTree and BucketedRedBlackTree: random
+ * inserts, Contains on random keys (about half of them present) and
+ * GetMin/GetMax.
+ *
+ * Usage: ./bplus-bench [tree size] [number of queries]
+ *
+**/
+
+using namespace std;
+
+// Runs fn once and returns the elapsed time in nanoseconds.
+template <class Fn>
+static double TimeNs(Fn fn) {
+    auto start = chrono::steady_clock::now();
+    fn();
+    auto stop = chrono::steady_clock::now();
+    return chrono::duration<double, nano>(stop - start).count();
+}
+
+// Fills a fresh Tree with keys and times it, then times the queries and
+// GetMin/GetMax. Hits and extremes are summed into check so the work cannot
+// be optimized away.
+template <class Tree>
+static void Measure(const string &name, const vector<int> &keys, const vector<int> &queries, long long &check) {
+    Tree tree;
+    double insertNs = TimeNs([&]() {
+        for (int key : keys) {
+            tree.TryInsert(key);
+        }
+    });
+    size_t hits = 0;
+    double containsNs = TimeNs([&]() {
+        for (int key : queries) {
+            hits += tree.Contains(key);
+        }
+    });
+    const size_t extremeRounds = 1000000;
+    long long extremes = 0;
+    double extremeNs = TimeNs([&]() {
+        for (size_t i = 0; i < extremeRounds; i++) {
+            extremes += tree.GetMin() + tree.GetMax();
+        }
+    });
+    check += hits + extremes;
+
+    cout << name << "insert " << insertNs / keys.size() << " ns/op, contains "
+         << containsNs / queries.size() << " ns/op, min+max " << extremeNs / extremeRounds
+         << " ns/op (" << hits << " hits)" << endl;
+}
+
+int main(int argc, char *argv[]) {
+    size_t treeSize = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 1000000;
+    size_t queryCount = (argc > 2) ? strtoull(argv[2], nullptr, 10) : 4000000;
+
+    mt19937 gen(1);
+    uniform_int_distribution<int> dist(0, static_cast<int>(min<size_t>(treeSize * 2, 1 << 30)));
+    vector<int> keys(treeSize), queries(queryCount);
+    for (int &key : keys) {
+        key = dist(gen);
+    }
+    for (int &key : queries) {
+        key = dist(gen);
+    }
+
+    long long check = 0;
+    cout << "tree size: " << treeSize << ", queries: " << queryCount << endl;
+    Measure<RedBlackTree>("RedBlackTree         ", keys, queries, check);
+    Measure<CompactRedBlackTree>("CompactRedBlackTree  ", keys, queries, check);
+    Measure<BucketedRedBlackTree>("BucketedRedBlackTree ", keys, queries, check);
+    Measure<BPlusTree<64>>("BPlusTree<64>        ", keys, queries, check);
+    Measure<BPlusTree<128>>("BPlusTree<128>       ", keys, queries, check);
+    return (check == 0) ? 1 : 0;
+}
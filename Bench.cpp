@@ -0,0 +1,232 @@
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory_resource>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+#include "RedBlackTree.h"
+#include "BPlusTree.h"
+#include "PageArena.h"
+
+/**
+ *
+ * Baseline benchmark suite. For every tree, key order and size it times
+ * Insert, Contains, GetMin/GetMax, a full in-order traversal and copy
+ * construction, and reports ns/op, heap allocations per op and the peak
+ * resident set size. Each case runs in its own child process so the peak
+ * RSS belongs to that case alone.
+ *
+ * Key orders: random, sorted, reverse (sorted descending) and clustered
+ * (runs of 64 consecutive keys starting at random points).
+ * Sizes run from 1K up to the maximum by factors of 10; 100M keys need
+ * several GB of memory. The peak RSS includes the key and query arrays,
+ * 8 bytes per key.
+ *
+ * The arena rows are a PmrRedBlackTree whose nodes, and its copy's, come
+ * from a PageArenaResource on 2MB transparent huge pages.
+ *
+ * Usage: ./bench [max size] [rbt|bplus|arena|all]
+ *
+**/
+
+using namespace std;
+
+// Every heap allocation in the process goes through these, so the cases
+// can count how many allocations an operation makes.
+static atomic<size_t> allocations(0);
+
+void *operator new(size_t size) {
+    allocations.fetch_add(1, memory_order_relaxed);
+    if (void *p = malloc(size ? size : 1)) return p;
+    throw bad_alloc();
+}
+
+void *operator new(size_t size, align_val_t align) {
+    allocations.fetch_add(1, memory_order_relaxed);
+    size_t alignment = static_cast<size_t>(align);
+    if (void *p = aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)) return p;
+    throw bad_alloc();
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete(void *p, align_val_t) noexcept { free(p); }
+void operator delete(void *p, size_t, align_val_t) noexcept { free(p); }
+
+enum class KeyOrder { Random, Sorted, Reverse, Clustered };
+
+// Result of timing one operation over ops calls.
+struct OpCost {
+    double nsPerOp;
+    double allocationsPerOp;
+};
+
+// Runs fn, which performs ops operations, and returns its cost per operation.
+template <class Fn>
+static OpCost Measure(size_t ops, Fn fn) {
+    size_t before = allocations.load(memory_order_relaxed);
+    auto start = chrono::steady_clock::now();
+    fn();
+    auto stop = chrono::steady_clock::now();
+    size_t made = allocations.load(memory_order_relaxed) - before;
+    double ns = chrono::duration<double, nano>(stop - start).count();
+    return OpCost{ns / max<size_t>(ops, 1), static_cast<double>(made) / max<size_t>(ops, 1)};
+}
+
+// Returns count distinct keys in the given order.
+static vector<int> MakeKeys(size_t count, KeyOrder order, mt19937 &gen) {
+    vector<int> keys(count);
+    switch (order) {
+        case KeyOrder::Sorted:
+        case KeyOrder::Reverse:
+            for (size_t i = 0; i < count; i++) {
+                keys[i] = static_cast<int>(i * 2);
+            }
+            if (order == KeyOrder::Reverse) reverse(keys.begin(), keys.end());
+            break;
+        case KeyOrder::Random:
+        case KeyOrder::Clustered: {
+            // Spread the keys (or the runs) over twice the key count, then
+            // shuffle whole runs so each run stays contiguous
+            size_t run = (order == KeyOrder::Clustered) ? 64 : 1;
+            for (size_t i = 0; i < count; i++) {
+                keys[i] = static_cast<int>(i * 2);
+            }
+            size_t runs = (count + run - 1) / run;
+            vector<size_t> starts(runs);
+            for (size_t r = 0; r < runs; r++) {
+                starts[r] = r;
+            }
+            shuffle(starts.begin(), starts.end(), gen);
+            vector<int> shuffled;
+            shuffled.reserve(count);
+            for (size_t r : starts) {
+                for (size_t i = r * run; i < min(count, (r + 1) * run); i++) {
+                    shuffled.push_back(keys[i]);
+                }
+            }
+            keys.swap(shuffled);
+            break;
+        }
+    }
+    return keys;
+}
+
+// Lookups for Contains: every other one is a key in the tree, the rest are
+// the odd numbers between them, which never are.
+static vector<int> MakeQueries(const vector<int> &keys, mt19937 &gen) {
+    vector<int> queries(keys.size());
+    uniform_int_distribution<size_t> pick(0, keys.size() - 1);
+    for (size_t i = 0; i < queries.size(); i++) {
+        int key = keys[pick(gen)];
+        queries[i] = (i % 2 == 0) ? key : key + 1;
+    }
+    return queries;
+}
+
+// Runs every measurement for one tree type, key order and size, and prints
+// one table row. Sums that depend on the results go into check so none of
+// the work can be optimized away.
+template <class Tree>
+static void RunCase(const string &treeName, const string &orderName, size_t count, KeyOrder order) {
+    mt19937 gen(static_cast<unsigned>(count) + static_cast<unsigned>(order));
+    vector<int> keys = MakeKeys(count, order, gen);
+    vector<int> queries = MakeQueries(keys, gen);
+    long long check = 0;
+
+    Tree tree;
+    OpCost insert = Measure(count, [&]() {
+        for (int key : keys) {
+            tree.Insert(key);
+        }
+    });
+    OpCost contains = Measure(queries.size(), [&]() {
+        for (int key : queries) {
+            check += tree.Contains(key);
+        }
+    });
+    const size_t extremeRounds = 1000000;
+    OpCost extremes = Measure(extremeRounds, [&]() {
+        for (size_t i = 0; i < extremeRounds; i++) {
+            check += tree.GetMin() + tree.GetMax();
+        }
+    });
+    OpCost traverse = Measure(count, [&]() {
+        tree.ForEach([&check](int key) { check += key; });
+    });
+    OpCost copy = Measure(count, [&]() {
+        Tree copied(tree);
+        check += copied.Size();
+    });
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    cout << left << setw(16) << treeName << setw(11) << orderName << right << setw(11) << count
+         << fixed << setprecision(1)
+         << setw(10) << insert.nsPerOp << setw(8) << setprecision(2) << insert.allocationsPerOp << setprecision(1)
+         << setw(10) << contains.nsPerOp
+         << setw(9) << extremes.nsPerOp
+         << setw(10) << traverse.nsPerOp
+         << setw(9) << copy.nsPerOp << setw(8) << setprecision(2) << copy.allocationsPerOp << setprecision(1)
+         << setw(10) << usage.ru_maxrss / 1024.0
+         << ((check == 0) ? "  (no work)" : "") << endl;
+}
+
+// Runs RunCase in a child process and waits for it. With pageArena the
+// child's default memory resource, which a default constructed
+// PmrRedBlackTree and its copies allocate from, becomes a huge page arena.
+template <class Tree>
+static bool RunIsolated(const string &treeName, const string &orderName, size_t count, KeyOrder order, bool pageArena = false) {
+    cout.flush();
+    pid_t child = fork();
+    if (child == 0) {
+        PageArenaResource arena;
+        if (pageArena) pmr::set_default_resource(&arena);
+        RunCase<Tree>(treeName, orderName, count, order);
+        cout.flush();
+        _exit(0);
+    }
+    int status = 0;
+    if (child < 0 || waitpid(child, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        cerr << treeName << " " << orderName << " " << count << " failed" << endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    size_t maxSize = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 1000000;
+    string trees = (argc > 2) ? argv[2] : "all";
+    if (trees != "rbt" && trees != "bplus" && trees != "arena" && trees != "all") {
+        cerr << "Usage: ./bench [max size] [rbt|bplus|arena|all]" << endl;
+        return 2;
+    }
+
+    const pair<const char *, KeyOrder> orders[] = {
+        {"random", KeyOrder::Random}, {"sorted", KeyOrder::Sorted},
+        {"reverse", KeyOrder::Reverse}, {"clustered", KeyOrder::Clustered},
+    };
+
+    cout << "All times are ns per key or per call; allocs are heap allocations per op; RSS is the case's peak in MB." << endl;
+    cout << left << setw(16) << "tree" << setw(11) << "keys" << right << setw(11) << "size"
+         << setw(10) << "insert" << setw(8) << "allocs" << setw(10) << "contains" << setw(9) << "min+max"
+         << setw(10) << "traverse" << setw(9) << "copy" << setw(8) << "allocs" << setw(10) << "peak RSS" << endl;
+    bool ok = true;
+    for (size_t count = 1000; count <= maxSize; count *= 10) {
+        for (const auto &order : orders) {
+            if (trees == "rbt" || trees == "all") ok &= RunIsolated<RedBlackTree>("RedBlackTree", order.first, count, order.second);
+            if (trees == "arena" || trees == "all") ok &= RunIsolated<PmrRedBlackTree>("RBT/arena", order.first, count, order.second, true);
+            if (trees == "bplus" || trees == "all") ok &= RunIsolated<BPlusTree<128>>("BPlusTree<128>", order.first, count, order.second);
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+#include "BucketedRedBlackTree.h"
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+using namespace std;
+
+// Insert
+// Adds a new key, throwing invalid_argument if it is already present.
+void BucketedRedBlackTree::Insert(int newData) {
+    if (!TryInsert(newData)) {
+        throw invalid_argument("Duplicate entry not allowed.");
+    }
+}
+
+// TryInsert
+// Same as Insert, but reports a duplicate by returning false instead of throwing.
+// The key goes into the first bucket whose bound is not below it, which is
+// split first if it is full.
+bool BucketedRedBlackTree::TryInsert(int newData) {
+    if (buckets.Size() == 0) {
+        buckets.Emplace(numeric_limits<int>::max(), Bucket());
+    }
+    auto it = buckets.LowerBound(newData);
+    const Bucket &found = it.value();
+    uint32_t pos = Position(found, newData);
+    if (pos < found.count && found.keys[pos] == newData) {
+        return false;
+    }
+    if (found.count == BUCKET_KEYS) {
+        Split(it);
+        it = buckets.LowerBound(newData);
+        pos = Position(it.value(), newData);
+    }
+    Bucket &bucket = buckets.ValueOf(it);
+    memmove(bucket.keys + pos + 1, bucket.keys + pos, (bucket.count - pos) * sizeof(int32_t));
+    bucket.keys[pos] = newData;
+    bucket.count++;
+    numItems++;
+    return true;
+}
+
+// Split
+// Moves the lower half of a full bucket into a new bucket placed before it,
+// bounded by the largest key it takes.
+void BucketedRedBlackTree::Split(BucketTree::const_iterator full) {
+    Bucket &upper = buckets.ValueOf(full);
+    Bucket lower;
+    uint32_t half = (BUCKET_KEYS + 1) / 2;
+    memcpy(lower.keys, upper.keys, half * sizeof(int32_t));
+    lower.count = half;
+    memmove(upper.keys, upper.keys + half, (upper.count - half) * sizeof(int32_t));
+    upper.count -= half;
+    buckets.Emplace(lower.keys[half - 1], lower);
+}
+
+// Remove
+// Deletes a key, returning false if it was not present. A bucket left empty
+// goes away, and one that would fit into its predecessor together with it
+// in half a bucket takes the predecessor's keys, so buckets stay at least
+// about a quarter full on average.
+bool BucketedRedBlackTree::Remove(int data) {
+    if (numItems == 0) return false;
+    auto it = buckets.LowerBound(data);
+    Bucket &bucket = buckets.ValueOf(it);
+    uint32_t pos = Position(bucket, data);
+    if (pos == bucket.count || bucket.keys[pos] != data) {
+        return false;
+    }
+    memmove(bucket.keys + pos, bucket.keys + pos + 1, (bucket.count - pos - 1) * sizeof(int32_t));
+    bucket.count--;
+    numItems--;
+
+    if (it != buckets.begin()) {
+        // Merging into this bucket keeps every bound right, even for the last one
+        auto prev = it;
+        --prev;
+        const Bucket &before = prev.value();
+        if (bucket.count == 0 || bucket.count + before.count <= BUCKET_KEYS / 2) {
+            memmove(bucket.keys + before.count, bucket.keys, bucket.count * sizeof(int32_t));
+            memcpy(bucket.keys, before.keys, before.count * sizeof(int32_t));
+            bucket.count += before.count;
+            buckets.Erase(prev);
+        }
+    } else if (bucket.count == 0 && buckets.Size() > 1) {
+        // The next bucket now covers this one's keys
+        buckets.Erase(it);
+    }
+    return true;
+}
+
+// Contains
+// Returns true if the tree contains the key: one descent over the bucket
+// bounds and one scan of a bucket.
+bool BucketedRedBlackTree::Contains(int data) const {
+    if (numItems == 0) return false;
+    const Bucket &bucket = buckets.LowerBound(data).value();
+    uint32_t pos = Position(bucket, data);
+    return pos < bucket.count && bucket.keys[pos] == data;
+}
+
+// GetMin
+// Returns the smallest key, the start of the first bucket, which is never
+// empty unless the whole tree is.
+int BucketedRedBlackTree::GetMin() const {
+    if (numItems == 0) throw underflow_error("Tree is empty.");
+    return buckets.begin().value().keys[0];
+}
+
+// GetMax
+// Returns the largest key, the end of the last bucket.
+int BucketedRedBlackTree::GetMax() const {
+    if (numItems == 0) throw underflow_error("Tree is empty.");
+    const Bucket &last = (--buckets.end()).value();
+    return last.keys[last.count - 1];
+}
+
+// Validate
+// Checks the bucket tree itself with RedBlackTree::Validate, then that
+// every bucket holds strictly increasing keys above the previous bucket's
+// bound and up to its own, that the last bound is INT32_MAX, that only a
+// lone bucket is ever empty, and that the counts add up to Size(). Returns
+// false at the first violation and, if problem is given, describes it there.
+bool BucketedRedBlackTree::Validate(string *problem) const {
+    auto fail = [problem](const char *what) {
+        if (problem != nullptr) *problem = what;
+        return false;
+    };
+    if (!buckets.Validate(problem)) return false;
+    if (buckets.Size() == 0) {
+        return (numItems == 0) ? true : fail("Keys counted but no buckets.");
+    }
+    size_t count = 0;
+    bool first = true;
+    int previousBound = 0;
+    for (auto it = buckets.begin(); it != buckets.end(); ++it) {
+        const Bucket &bucket = it.value();
+        if (bucket.count > BUCKET_KEYS) return fail("Bucket count out of range.");
+        if (bucket.count == 0 && buckets.Size() > 1) return fail("Empty bucket next to others.");
+        for (uint32_t i = 0; i < bucket.count; i++) {
+            if (i > 0 && bucket.keys[i - 1] >= bucket.keys[i]) return fail("Bucket keys out of order.");
+            if (bucket.keys[i] > it.key()) return fail("Key above its bucket's bound.");
+            if (!first && bucket.keys[i] <= previousBound) return fail("Key not above the previous bound.");
+        }
+        count += bucket.count;
+        previousBound = it.key();
+        first = false;
+    }
+    if (previousBound != numeric_limits<int>::max()) return fail("Last bucket is not bounded by INT32_MAX.");
+    if (count != numItems) return fail("Bucket counts do not add up to the size.");
+    return true;
+}
@@ -0,0 +1,83 @@
+#ifndef BUCKETEDREDBLACKTREE_H
+#define BUCKETEDREDBLACKTREE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "RedBlackTree.h"
+#include "KeySearch.h"
+
+using namespace std;
+
+
+// BucketedRedBlackTree
+// int set with the Insert/TryInsert/Remove/Contains/GetMin/GetMax/Size
+// interface of RedBlackTree, where the bottom levels of the tree are
+// replaced by sorted buckets of up to BUCKET_KEYS keys. The buckets are the
+// values of a red-black tree keyed by the largest key each bucket may hold,
+// so a lookup is one descent of a tree about BUCKET_KEYS times smaller
+// followed by a branch-free SIMD count over one 64 byte bucket (see
+// CountLessInt32), where a plain tree would chase four more pointers.
+// A full bucket splits in two; a bucket that empties, or shrinks until it
+// fits into its predecessor's free half, is merged back into it.
+// Full buckets cost about 7 bytes per key and half full ones about 14,
+// against about 40 for an RBTNode.
+class BucketedRedBlackTree {
+
+	public:
+		static const uint32_t BUCKET_KEYS = 15;
+
+		BucketedRedBlackTree() = default;
+
+		void Insert(int newData);
+		bool TryInsert(int newData);
+		bool Remove(int data);
+
+		bool Contains(int data) const;
+		size_t Size() const { return numItems; };
+		size_t BucketCount() const { return buckets.Size(); };
+		int GetMin() const;
+		int GetMax() const;
+
+		template <class Visitor>
+		void ForEach(Visitor visit) const;
+
+		bool Validate(string *problem = nullptr) const;
+
+	private:
+		// The count follows the keys so one scan of all 16 lanes covers
+		// every key; the lanes past count are masked off.
+		struct Bucket {
+			int32_t keys[BUCKET_KEYS] = {};
+			uint32_t count = 0;
+		};
+		static_assert(sizeof(Bucket) == 64, "A bucket fills one cache line");
+
+		using BucketTree = RedBlackTreeMap<int, Bucket>;
+
+		// Bucket under key k holds the keys above the previous bucket's key
+		// and up to k. The last bucket is always under INT32_MAX, so every
+		// key has a bucket once the first one exists.
+		BucketTree buckets;
+		size_t numItems = 0;
+
+		static uint32_t Position(const Bucket &bucket, int key) {
+			return CountLessInt32<BUCKET_KEYS + 1>(bucket.keys, bucket.count, key);
+		};
+		void Split(BucketTree::const_iterator full);
+};
+
+
+// ForEach
+// Calls visit(key) in key order, one bucket after another.
+template <class Visitor>
+void BucketedRedBlackTree::ForEach(Visitor visit) const {
+    for (auto it = buckets.begin(); it != buckets.end(); ++it) {
+        const Bucket &bucket = it.value();
+        for (uint32_t i = 0; i < bucket.count; i++) {
+            visit(bucket.keys[i]);
+        }
+    }
+}
+
+#endif
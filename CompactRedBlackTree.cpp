@@ -0,0 +1,326 @@
+#include "CompactRedBlackTree.h"
+#include <string>
+#include <stdexcept>
+
+using namespace std;
+
+// Default Constructor
+// Initializes an empty tree.
+CompactRedBlackTree::CompactRedBlackTree() {
+    root = NIL;
+}
+
+// Constructor that creates a tree with a single black root node.
+CompactRedBlackTree::CompactRedBlackTree(int newData) {
+    root = NewNode(newData, COLOR_BLACK);
+}
+
+// NewNode
+// Appends a detached node to the node array and returns its index.
+uint32_t CompactRedBlackTree::NewNode(int data, unsigned short int color) {
+    if (nodes.size() >= NIL) {
+        throw length_error("Compact tree is full.");
+    }
+    CompactRBTNode node;
+    node.data = data;
+    node.left = NIL;
+    node.right = NIL;
+    node.parentColor = (NIL << 1) | color;
+    nodes.push_back(node);
+    return static_cast<uint32_t>(nodes.size() - 1);
+}
+
+// Insert
+// Adds a new key, maintaining Red-Black properties.
+void CompactRedBlackTree::Insert(int newData) {
+    if (!TryInsert(newData)) {
+        throw invalid_argument("Duplicate entry not allowed.");
+    }
+}
+
+// TryInsert
+// Same as Insert, but reports a duplicate by returning false instead of throwing.
+bool CompactRedBlackTree::TryInsert(int newData) {
+    uint32_t newNode = BasicInsert(newData);
+    if (newNode == NIL) {
+        return false;
+    }
+    InsertFixUp(newNode);
+    return true;
+}
+
+// BasicInsert
+// Standard Binary Search Tree insert that checks for a duplicate on the way down.
+// Returns the index of the new red leaf, or NIL if the key is already present.
+uint32_t CompactRedBlackTree::BasicInsert(int newData) {
+    uint32_t curr = root;
+    uint32_t parent = NIL;
+    bool goLeft = false;
+
+    while (curr != NIL) {
+        const CompactRBTNode &node = nodes[curr];
+        if (newData == node.data) {
+            return NIL;
+        }
+        parent = curr;
+        goLeft = newData < node.data;
+        curr = goLeft ? node.left : node.right;
+    }
+
+    uint32_t node = NewNode(newData, COLOR_RED);
+    SetParent(node, parent);
+    if (parent == NIL) {
+        root = node;
+    } else if (goLeft) {
+        nodes[parent].left = node;
+    } else {
+        nodes[parent].right = node;
+    }
+    return node;
+}
+
+// InsertFixUp
+// Fixes Red-Black Tree properties after insertion by rotating/recoloring.
+void CompactRedBlackTree::InsertFixUp(uint32_t node) {
+    while (Parent(node) != NIL && Color(Parent(node)) == COLOR_RED) {
+        uint32_t uncle = GetUncle(node);
+        uint32_t grandparent = Parent(Parent(node));
+
+        if (uncle != NIL && Color(uncle) == COLOR_RED) {
+            // Case 1: Parent and Uncle are both red - recolor and move up the tree
+            SetColor(Parent(node), COLOR_BLACK);
+            SetColor(uncle, COLOR_BLACK);
+            SetColor(grandparent, COLOR_RED);
+            node = grandparent;
+        } else {
+            // Cases 2 and 3: Rotation cases
+            if (IsLeftChild(node) && IsLeftChild(Parent(node))) {
+                RightRotate(grandparent);
+                SetColor(Parent(node), COLOR_BLACK);
+                SetColor(grandparent, COLOR_RED);
+            } else if (IsRightChild(node) && IsRightChild(Parent(node))) {
+                LeftRotate(grandparent);
+                SetColor(Parent(node), COLOR_BLACK);
+                SetColor(grandparent, COLOR_RED);
+            } else if (IsLeftChild(node) && IsRightChild(Parent(node))) {
+                RightRotate(Parent(node));
+                node = nodes[node].right;
+            } else {
+                LeftRotate(Parent(node));
+                node = nodes[node].left;
+            }
+        }
+    }
+    SetColor(root, COLOR_BLACK);
+}
+
+// LeftRotate
+// Performs a left rotation around a given node.
+void CompactRedBlackTree::LeftRotate(uint32_t node) {
+    uint32_t rightChild = nodes[node].right;
+    uint32_t parent = Parent(node);
+    nodes[node].right = nodes[rightChild].left;
+    if (nodes[rightChild].left != NIL) {
+        SetParent(nodes[rightChild].left, node);
+    }
+    SetParent(rightChild, parent);
+    if (parent == NIL) {
+        root = rightChild;
+    } else if (node == nodes[parent].left) {
+        nodes[parent].left = rightChild;
+    } else {
+        nodes[parent].right = rightChild;
+    }
+    nodes[rightChild].left = node;
+    SetParent(node, rightChild);
+}
+
+// RightRotate
+// Performs a right rotation around a given node.
+void CompactRedBlackTree::RightRotate(uint32_t node) {
+    uint32_t leftChild = nodes[node].left;
+    uint32_t parent = Parent(node);
+    nodes[node].left = nodes[leftChild].right;
+    if (nodes[leftChild].right != NIL) {
+        SetParent(nodes[leftChild].right, node);
+    }
+    SetParent(leftChild, parent);
+    if (parent == NIL) {
+        root = leftChild;
+    } else if (node == nodes[parent].left) {
+        nodes[parent].left = leftChild;
+    } else {
+        nodes[parent].right = leftChild;
+    }
+    nodes[leftChild].right = node;
+    SetParent(node, leftChild);
+}
+
+// GetUncle
+// Finds and returns the uncle of a node (NIL if there is none).
+uint32_t CompactRedBlackTree::GetUncle(uint32_t node) const {
+    uint32_t parent = Parent(node);
+    uint32_t grandparent = (parent != NIL) ? Parent(parent) : NIL;
+    if (grandparent == NIL) return NIL;
+    if (nodes[grandparent].left == parent) return nodes[grandparent].right;
+    return nodes[grandparent].left;
+}
+
+// IsLeftChild
+// Returns true if node is a left child.
+bool CompactRedBlackTree::IsLeftChild(uint32_t node) const {
+    uint32_t parent = Parent(node);
+    return parent != NIL && node == nodes[parent].left;
+}
+
+// IsRightChild
+// Returns true if node is a right child.
+bool CompactRedBlackTree::IsRightChild(uint32_t node) const {
+    uint32_t parent = Parent(node);
+    return parent != NIL && node == nodes[parent].right;
+}
+
+// Contains
+// Returns true if the tree contains a given value.
+bool CompactRedBlackTree::Contains(int data) const {
+    return (Get(data) != NIL);
+}
+
+// Get
+// Returns the index of the node with given data, or NIL if not found.
+uint32_t CompactRedBlackTree::Get(int data) const {
+    uint32_t curr = root;
+    while (curr != NIL) {
+        const CompactRBTNode &node = nodes[curr];
+        if (data == node.data) {
+            return curr;
+        }
+        curr = (data < node.data) ? node.left : node.right;
+    }
+    return NIL;
+}
+
+// GetMin
+// Finds and returns the minimum data value in the tree.
+int CompactRedBlackTree::GetMin() const {
+    if (root == NIL) throw underflow_error("Tree is empty.");
+    uint32_t curr = root;
+    while (nodes[curr].left != NIL) {
+        curr = nodes[curr].left;
+    }
+    return nodes[curr].data;
+}
+
+// GetMax
+// Finds and returns the maximum data value in the tree.
+int CompactRedBlackTree::GetMax() const {
+    if (root == NIL) throw underflow_error("Tree is empty.");
+    uint32_t curr = root;
+    while (nodes[curr].right != NIL) {
+        curr = nodes[curr].right;
+    }
+    return nodes[curr].data;
+}
+
+// ToInfixString / ToPrefixString / ToPostfixString
+// Same format as RedBlackTree, e.g. " B12  R5 ".
+string CompactRedBlackTree::ToInfixString() const {
+    string out;
+    AppendInfix(root, out);
+    return out;
+}
+
+string CompactRedBlackTree::ToPrefixString() const {
+    string out;
+    AppendPrefix(root, out);
+    return out;
+}
+
+string CompactRedBlackTree::ToPostfixString() const {
+    string out;
+    AppendPostfix(root, out);
+    return out;
+}
+
+void CompactRedBlackTree::AppendInfix(uint32_t n, string &out) const {
+    if (n == NIL) return;
+    AppendInfix(nodes[n].left, out);
+    AppendNode(n, out);
+    AppendInfix(nodes[n].right, out);
+}
+
+void CompactRedBlackTree::AppendPrefix(uint32_t n, string &out) const {
+    if (n == NIL) return;
+    AppendNode(n, out);
+    AppendPrefix(nodes[n].left, out);
+    AppendPrefix(nodes[n].right, out);
+}
+
+void CompactRedBlackTree::AppendPostfix(uint32_t n, string &out) const {
+    if (n == NIL) return;
+    AppendPostfix(nodes[n].left, out);
+    AppendPostfix(nodes[n].right, out);
+    AppendNode(n, out);
+}
+
+// AppendNode
+// Appends one node as " <color><data> ".
+void CompactRedBlackTree::AppendNode(uint32_t n, string &out) const {
+    out += ' ';
+    out += (Color(n) == COLOR_RED) ? 'R' : 'B';
+    out += to_string(nodes[n].data);
+    out += ' ';
+}
+
+// Validate
+// Checks the same invariants as RedBlackTree::Validate with one walk:
+// keys strictly increasing in order, a black root, no red-red link,
+// equal black heights, parent indexes that match the child indexes, and
+// every array slot reached exactly once from the root. Returns false at
+// the first violation and, if problem is given, describes it there.
+bool CompactRedBlackTree::Validate(string *problem) const {
+    auto fail = [problem](const char *what) {
+        if (problem != nullptr) *problem = what;
+        return false;
+    };
+    if (root == NIL) {
+        return nodes.empty() ? true : fail("Empty tree with allocated nodes.");
+    }
+    if (root >= nodes.size()) return fail("Root index out of range.");
+    if (Parent(root) != NIL) return fail("Root has a parent.");
+    if (Color(root) != COLOR_BLACK) return fail("Root is red.");
+
+    // low and high are the nearest ancestors the node's key must lie between
+    struct Visit {
+        uint32_t node;
+        uint32_t low;
+        uint32_t high;
+        int blacks;
+    };
+    vector<Visit> pending;
+    pending.push_back(Visit{root, NIL, NIL, 1});
+    int blackHeight = -1;
+    size_t count = 0;
+    while (!pending.empty()) {
+        Visit v = pending.back();
+        pending.pop_back();
+        const CompactRBTNode &n = nodes[v.node];
+        if (++count > nodes.size()) return fail("A node is reached twice.");
+        if (v.low != NIL && !(nodes[v.low].data < n.data)) return fail("Keys out of order.");
+        if (v.high != NIL && !(n.data < nodes[v.high].data)) return fail("Keys out of order.");
+        for (uint32_t child : {n.left, n.right}) {
+            if (child == NIL) {
+                if (blackHeight == -1) blackHeight = v.blacks;
+                if (blackHeight != v.blacks) return fail("Black heights differ.");
+                continue;
+            }
+            if (child >= nodes.size()) return fail("Child index out of range.");
+            if (Parent(child) != v.node) return fail("Parent link does not match child link.");
+            if (Color(v.node) == COLOR_RED && Color(child) == COLOR_RED) return fail("Red node with a red child.");
+            bool isLeft = (child == n.left);
+            pending.push_back(Visit{child, isLeft ? v.low : v.node, isLeft ? v.node : v.high, v.blacks + (Color(child) == COLOR_BLACK)});
+        }
+    }
+    if (count != nodes.size()) return fail("Nodes not reachable from the root.");
+    return true;
+}
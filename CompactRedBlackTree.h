@@ -0,0 +1,100 @@
+#ifndef COMPACTREDBLACKTREE_H
+#define COMPACTREDBLACKTREE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "RedBlackTree.h"
+
+using namespace std;
+
+
+// Compact node: 16 bytes instead of the ~40 an RBTNode pads out to.
+// Nodes are addressed by their index in the tree's node array. The color
+// lives in the low bit of parentColor and the parent index in the upper 31.
+struct CompactRBTNode {
+	int data;
+	uint32_t left;
+	uint32_t right;
+	uint32_t parentColor;
+};
+
+
+// CompactRedBlackTree
+// Same public interface and balancing as RedBlackTree, but stored in one
+// index-addressed array so large sets take far less cache and RAM.
+// Holds at most 2^31 - 1 keys.
+class CompactRedBlackTree {
+
+	public:
+		static const uint32_t NIL = 0x7FFFFFFF;
+
+		CompactRedBlackTree();
+		CompactRedBlackTree(int newData);
+
+		string ToInfixString() const;
+		string ToPrefixString() const;
+		string ToPostfixString() const;
+
+		void Insert(int newData);
+		bool TryInsert(int newData);
+
+		bool Contains(int data) const;
+		size_t Size() const {return nodes.size();};
+		int GetMin() const;
+		int GetMax() const;
+
+		template <class Visitor>
+		void ForEach(Visitor visit) const;
+
+		bool Validate(string *problem = nullptr) const;
+
+	private:
+		vector<CompactRBTNode> nodes;
+		uint32_t root = NIL;
+
+		uint32_t Parent(uint32_t n) const { return nodes[n].parentColor >> 1; };
+		unsigned short int Color(uint32_t n) const { return nodes[n].parentColor & 1; };
+		void SetParent(uint32_t n, uint32_t p) { nodes[n].parentColor = (p << 1) | (nodes[n].parentColor & 1); };
+		void SetColor(uint32_t n, unsigned short int c) { nodes[n].parentColor = (nodes[n].parentColor & ~1u) | c; };
+
+		void AppendInfix(uint32_t n, string &out) const;
+		void AppendPrefix(uint32_t n, string &out) const;
+		void AppendPostfix(uint32_t n, string &out) const;
+		void AppendNode(uint32_t n, string &out) const;
+
+		uint32_t NewNode(int data, unsigned short int color);
+		uint32_t BasicInsert(int newData);
+		void InsertFixUp(uint32_t node);
+
+		uint32_t GetUncle(uint32_t node) const;
+
+		bool IsLeftChild(uint32_t node) const;
+		bool IsRightChild(uint32_t node) const;
+
+		void LeftRotate(uint32_t node);
+		void RightRotate(uint32_t node);
+
+		uint32_t Get(int data) const;
+};
+
+
+// ForEach
+// Calls visit(key) in key order, walking the tree with an explicit stack.
+template <class Visitor>
+void CompactRedBlackTree::ForEach(Visitor visit) const {
+    vector<uint32_t> path;
+    uint32_t curr = root;
+    while (curr != NIL || !path.empty()) {
+        while (curr != NIL) {
+            path.push_back(curr);
+            curr = nodes[curr].left;
+        }
+        curr = path.back();
+        path.pop_back();
+        visit(nodes[curr].data);
+        curr = nodes[curr].right;
+    }
+}
+
+#endif
@@ -0,0 +1,113 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include "RedBlackTree.h"
+#include "ConcurrentRedBlackTree.h"
+
+/**
+ *
+ * Read scaling of ConcurrentRedBlackTree against a RedBlackTree behind one
+ * global mutex. For every reader count from 1 to the maximum, the readers
+ * call Contains on random keys while one writer keeps inserting and removing.
+ *
+ * Usage: ./concurrent-bench [tree size] [max reader threads] [ms per run]
+ *
+**/
+
+using namespace std;
+
+// Starts readers reader threads calling read(gen) and one writer thread
+// calling write(gen) until ms milliseconds have passed. Returns the reads and
+// writes completed per second, in millions and thousands. Hits are counted
+// so the lookups cannot be optimized away.
+template <class Read, class Write>
+static pair<double, double> Run(size_t readers, int ms, Read read, Write write) {
+    auto start = chrono::steady_clock::now();
+    atomic<bool> stop(false);
+    atomic<size_t> reads(0), writes(0), hits(0);
+    vector<thread> threads;
+    for (size_t t = 0; t < readers; t++) {
+        threads.emplace_back([&, t]() {
+            mt19937 gen(t + 1);
+            size_t done = 0, found = 0;
+            while (!stop.load(memory_order_relaxed)) {
+                for (int i = 0; i < 64; i++) {
+                    found += read(gen);
+                }
+                done += 64;
+            }
+            reads += done;
+            hits += found;
+        });
+    }
+    threads.emplace_back([&]() {
+        mt19937 gen(1000);
+        size_t done = 0;
+        while (!stop.load(memory_order_relaxed)) {
+            write(gen);
+            done++;
+        }
+        writes += done;
+    });
+
+    // The sleep can overrun when the threads outnumber the cores, so the
+    // rates use the time that actually passed
+    this_thread::sleep_for(chrono::milliseconds(ms));
+    stop = true;
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    for (thread &th : threads) {
+        th.join();
+    }
+    return make_pair(reads / seconds / 1e6, writes / seconds / 1e3);
+}
+
+int main(int argc, char *argv[]) {
+    size_t treeSize = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 1000000;
+    size_t maxReaders = (argc > 2) ? strtoull(argv[2], nullptr, 10) : thread::hardware_concurrency();
+    int ms = (argc > 3) ? atoi(argv[3]) : 500;
+    if (maxReaders == 0) maxReaders = 1;
+
+    int keyRange = static_cast<int>(treeSize * 2);
+    mt19937 gen(1);
+    uniform_int_distribution<int> dist(0, keyRange);
+
+    RedBlackTree locked;
+    mutex lock;
+    ConcurrentRedBlackTree<int> concurrent;
+    while (locked.Size() < treeSize) {
+        int key = dist(gen);
+        if (locked.TryInsert(key)) concurrent.Insert(key);
+    }
+
+    cout << "tree size: " << treeSize << ", one writer, " << ms << " ms per run" << endl;
+    cout << "readers | mutex Mreads/s  Kwrites/s | concurrent Mreads/s  Kwrites/s" << endl;
+    for (size_t readers = 1; readers <= maxReaders; readers++) {
+        pair<double, double> mutexRates = Run(readers, ms,
+            [&](mt19937 &g) {
+                int key = static_cast<int>(g() % keyRange);
+                lock_guard<mutex> guard(lock);
+                return locked.Contains(key);
+            },
+            [&](mt19937 &g) {
+                int key = static_cast<int>(g() % keyRange);
+                lock_guard<mutex> guard(lock);
+                if (!locked.Remove(key)) locked.Insert(key);
+            });
+        pair<double, double> concurrentRates = Run(readers, ms,
+            [&](mt19937 &g) {
+                return concurrent.Contains(static_cast<int>(g() % keyRange));
+            },
+            [&](mt19937 &g) {
+                int key = static_cast<int>(g() % keyRange);
+                if (!concurrent.Remove(key)) concurrent.Insert(key);
+            });
+        cout << readers << "       | " << mutexRates.first << "  " << mutexRates.second
+             << " | " << concurrentRates.first << "  " << concurrentRates.second << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,289 @@
+#ifndef CONCURRENTREDBLACKTREE_H
+#define CONCURRENTREDBLACKTREE_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "RedBlackTree.h"
+#include "PersistentRedBlackTree.h"
+
+using namespace std;
+
+
+// ConcurrentRedBlackTree
+// Ordered set or map that any number of threads may read and write at once.
+// Writers are serialized by a mutex and never change a node that readers can
+// see: every write copies the path it touches and publishes a new root with
+// one atomic store, so readers take no locks, never wait for a writer and
+// always see one complete version of the tree.
+// Replaced nodes are freed by epoch based reclamation. Each reader marks one
+// of READER_SLOTS slots with the epoch it started in, and a retired node is
+// only deleted once every reader that could still reach it has left.
+// Writes are done by PathCopier, which rebuilds every node it touches
+// unless the current write created it.
+template <class Key, class Value = NoValue, class Compare = less<Key>>
+class ConcurrentRedBlackTree {
+
+	public:
+		static constexpr size_t READER_SLOTS = 64;
+
+		ConcurrentRedBlackTree() = default;
+		explicit ConcurrentRedBlackTree(const Compare &comp) : comp(comp) {};
+		~ConcurrentRedBlackTree();
+
+		ConcurrentRedBlackTree(const ConcurrentRedBlackTree &other) = delete;
+		ConcurrentRedBlackTree &operator=(const ConcurrentRedBlackTree &other) = delete;
+
+		void Insert(const Key &key, const Value &value = Value());
+		bool TryInsert(const Key &key, const Value &value = Value());
+		bool Remove(const Key &key);
+
+		bool Contains(const Key &key) const;
+		bool TryGet(const Key &key, Value &value) const;
+		size_t Size() const { return numItems.load(memory_order_relaxed); };
+		Key GetMin() const;
+		Key GetMax() const;
+
+		template <class Visitor>
+		void ForEach(Visitor visit) const;
+
+	private:
+		using Node = PathCopyNode<Key, Value>;
+		using Writer = PathCopier<Key, Value, Compare>;
+
+		struct alignas(64) ReaderSlot {
+			atomic<uint64_t> epoch{0};
+		};
+
+		struct RetiredBatch {
+			uint64_t epoch;
+			vector<Node *> nodes;
+		};
+
+		// Holds a reader slot for the lifetime of one read.
+		class ReadGuard {
+			public:
+				explicit ReadGuard(const ConcurrentRedBlackTree &tree);
+				~ReadGuard() { slot->epoch.store(0, memory_order_release); };
+				ReadGuard(const ReadGuard &other) = delete;
+				ReadGuard &operator=(const ReadGuard &other) = delete;
+			private:
+				ReaderSlot *slot;
+		};
+
+		Compare comp;
+		atomic<Node *> root{nullptr};
+		atomic<size_t> numItems{0};
+		mutable ReaderSlot readers[READER_SLOTS];
+		atomic<uint64_t> globalEpoch{1};
+
+		// Writer state, guarded by writeLock
+		mutex writeLock;
+		vector<Node *> replaced;
+		deque<RetiredBatch> retired;
+
+		void Publish(Node *newRoot);
+		void Reclaim();
+
+		static void DeleteTree(Node *n);
+};
+
+
+#define CRBT_TEMPLATE template <class Key, class Value, class Compare>
+#define CRBT_CLASS ConcurrentRedBlackTree<Key, Value, Compare>
+
+// Destructor
+// Frees the current version and everything still waiting for reclamation.
+// No other thread may be using the tree.
+CRBT_TEMPLATE
+CRBT_CLASS::~ConcurrentRedBlackTree() {
+    DeleteTree(root.load());
+    for (RetiredBatch &batch : retired) {
+        for (Node *n : batch.nodes) {
+            delete n;
+        }
+    }
+}
+
+// ReadGuard
+// Claims a free reader slot, starting from one picked by the thread id, and
+// stamps it with the current epoch before the reader loads the root.
+CRBT_TEMPLATE
+CRBT_CLASS::ReadGuard::ReadGuard(const ConcurrentRedBlackTree &tree) {
+    size_t i = hash<thread::id>()(this_thread::get_id()) % READER_SLOTS;
+    while (true) {
+        uint64_t epoch = tree.globalEpoch.load();
+        uint64_t expected = 0;
+        if (tree.readers[i].epoch.compare_exchange_strong(expected, epoch)) {
+            slot = &tree.readers[i];
+            return;
+        }
+        i = (i + 1) % READER_SLOTS;
+    }
+}
+
+// Insert
+// Adds a key, throwing invalid_argument if it is already present.
+CRBT_TEMPLATE
+void CRBT_CLASS::Insert(const Key &key, const Value &value) {
+    if (!TryInsert(key, value)) {
+        throw invalid_argument("Duplicate entry not allowed.");
+    }
+}
+
+// TryInsert
+// Adds a key with a value. Returns false and changes nothing if the key is
+// already present.
+CRBT_TEMPLATE
+bool CRBT_CLASS::TryInsert(const Key &key, const Value &value) {
+    lock_guard<mutex> guard(writeLock);
+    Node *top = root.load(memory_order_relaxed);
+    if (Writer::Get(top, key, comp) != nullptr) return false;
+
+    Writer writer(comp, &replaced);
+    Node *newTop = writer.Insert(top, key, value);
+    writer.Keep();
+    Publish(newTop);
+    numItems.fetch_add(1, memory_order_relaxed);
+    return true;
+}
+
+// Remove
+// Deletes a key. Returns false if it was not present.
+CRBT_TEMPLATE
+bool CRBT_CLASS::Remove(const Key &key) {
+    lock_guard<mutex> guard(writeLock);
+    Node *top = root.load(memory_order_relaxed);
+    if (Writer::Get(top, key, comp) == nullptr) return false;
+
+    Writer writer(comp, &replaced);
+    Node *newTop = writer.Remove(top, key);
+    writer.Keep();
+    Publish(newTop);
+    numItems.fetch_sub(1, memory_order_relaxed);
+    return true;
+}
+
+// Contains
+// Returns true if the tree contains the key. Never blocks.
+CRBT_TEMPLATE
+bool CRBT_CLASS::Contains(const Key &key) const {
+    ReadGuard guard(*this);
+    return Writer::Get(root.load(), key, comp) != nullptr;
+}
+
+// TryGet
+// Copies the value stored under key into value and returns true, or returns
+// false if the key is not present. Never blocks.
+CRBT_TEMPLATE
+bool CRBT_CLASS::TryGet(const Key &key, Value &value) const {
+    ReadGuard guard(*this);
+    const Node *n = Writer::Get(root.load(), key, comp);
+    if (n == nullptr) return false;
+    value = n->value;
+    return true;
+}
+
+// GetMin
+// Returns the smallest key. Throws underflow_error if the tree is empty.
+CRBT_TEMPLATE
+Key CRBT_CLASS::GetMin() const {
+    ReadGuard guard(*this);
+    const Node *n = root.load();
+    if (n == nullptr) throw underflow_error("Tree is empty.");
+    while (n->left != nullptr) n = n->left;
+    return n->data;
+}
+
+// GetMax
+// Returns the largest key. Throws underflow_error if the tree is empty.
+CRBT_TEMPLATE
+Key CRBT_CLASS::GetMax() const {
+    ReadGuard guard(*this);
+    const Node *n = root.load();
+    if (n == nullptr) throw underflow_error("Tree is empty.");
+    while (n->right != nullptr) n = n->right;
+    return n->data;
+}
+
+// ForEach
+// Calls visit(key) in key order over the version that was current
+// when the call started. Writers are not held up, but the version's nodes
+// stay allocated until visit returns for the last key.
+CRBT_TEMPLATE
+template <class Visitor>
+void CRBT_CLASS::ForEach(Visitor visit) const {
+    ReadGuard guard(*this);
+    vector<const Node *> path;
+    const Node *n = root.load();
+    while (n != nullptr || !path.empty()) {
+        while (n != nullptr) {
+            path.push_back(n);
+            n = n->left;
+        }
+        n = path.back();
+        path.pop_back();
+        visit(n->data);
+        n = n->right;
+    }
+}
+
+// Publish
+// Makes newRoot the version readers see, then tags the nodes this write
+// replaced with the epoch it ended. A reader that starts afterwards reads a
+// later epoch and can only see the new version.
+CRBT_TEMPLATE
+void CRBT_CLASS::Publish(Node *newRoot) {
+    root.store(newRoot);
+    uint64_t epoch = globalEpoch.fetch_add(1);
+    if (!replaced.empty()) {
+        retired.push_back(RetiredBatch{epoch, move(replaced)});
+        replaced.clear();
+    }
+    Reclaim();
+}
+
+// Reclaim
+// Deletes the retired batches that no active reader can still reach, that
+// is those retired before the oldest epoch in any reader slot.
+CRBT_TEMPLATE
+void CRBT_CLASS::Reclaim() {
+    if (retired.empty()) return;
+    uint64_t oldest = UINT64_MAX;
+    for (const ReaderSlot &slot : readers) {
+        uint64_t epoch = slot.epoch.load();
+        if (epoch != 0 && epoch < oldest) oldest = epoch;
+    }
+    while (!retired.empty() && retired.front().epoch < oldest) {
+        for (Node *n : retired.front().nodes) {
+            delete n;
+        }
+        retired.pop_front();
+    }
+}
+
+// DeleteTree
+// Frees every node below and including n.
+CRBT_TEMPLATE
+void CRBT_CLASS::DeleteTree(Node *n) {
+    vector<Node *> pending;
+    if (n != nullptr) pending.push_back(n);
+    while (!pending.empty()) {
+        Node *next = pending.back();
+        pending.pop_back();
+        if (next->left) pending.push_back(next->left);
+        if (next->right) pending.push_back(next->right);
+        delete next;
+    }
+}
+
+#undef CRBT_CLASS
+#undef CRBT_TEMPLATE
+
+#endif
@@ -0,0 +1,90 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "RedBlackTree.h"
+
+/**
+ *
+ * Compares batched ContainsMany against a loop of single Contains calls.
+ * A share of the queries (half by default) are keys in the tree and the
+ * rest are random, mostly misses, so both paths see hits and misses.
+ *
+ * Usage: ./contains-bench [tree size] [number of queries] [hit percent]
+ *
+**/
+
+using namespace std;
+
+// Runs fn once and returns the elapsed time in nanoseconds.
+template <class Fn>
+static double TimeNs(Fn fn) {
+    auto start = chrono::steady_clock::now();
+    fn();
+    auto stop = chrono::steady_clock::now();
+    return chrono::duration<double, nano>(stop - start).count();
+}
+
+int main(int argc, char *argv[]) {
+    size_t treeSize = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 1000000;
+    size_t queryCount = (argc > 2) ? strtoull(argv[2], nullptr, 10) : 4000000;
+    int hitPercent = (argc > 3) ? atoi(argv[3]) : 50;
+
+    mt19937 gen(1);
+    uniform_int_distribution<int> dist(0, 1 << 30);
+
+    // Random inserts scatter the nodes the way a long-lived tree would
+    RedBlackTree rbt;
+    vector<int> inserted;
+    inserted.reserve(treeSize);
+    while (rbt.Size() < treeSize) {
+        int key = dist(gen);
+        if (rbt.TryInsert(key)) inserted.push_back(key);
+    }
+
+    // Stored keys are picked at random too, so hits do not walk the tree in order
+    uniform_int_distribution<size_t> pick(0, inserted.empty() ? 0 : inserted.size() - 1);
+    uniform_int_distribution<int> percent(0, 99);
+    vector<int> queries(queryCount);
+    for (size_t i = 0; i < queryCount; i++) {
+        queries[i] = (!inserted.empty() && percent(gen) < hitPercent) ? inserted[pick(gen)] : dist(gen);
+    }
+
+    vector<bool> single(queryCount);
+    size_t singleHits = 0;
+    double singleNs = TimeNs([&]() {
+        for (size_t i = 0; i < queryCount; i++) {
+            single[i] = rbt.Contains(queries[i]);
+        }
+    });
+
+    bool *batched = new bool[queryCount];
+    double batchedNs = TimeNs([&]() {
+        rbt.ContainsMany(queries.data(), queryCount, batched);
+    });
+
+    size_t batchedHits = 0;
+    size_t mismatches = 0;
+    for (size_t i = 0; i < queryCount; i++) {
+        singleHits += single[i];
+        batchedHits += batched[i];
+        if (single[i] != batched[i]) {
+            if (mismatches == 0) cerr << "First mismatch at query " << i << endl;
+            mismatches++;
+        }
+    }
+    delete[] batched;
+
+    cout << "tree size:      " << treeSize << endl;
+    cout << "queries:        " << queryCount << " (" << singleHits << " hits, " << hitPercent
+         << "% drawn from the tree)" << endl;
+    cout << "results match:  " << ((mismatches == 0) ? "yes" : "NO") << " (" << mismatches << " of "
+         << queryCount << " differ, " << batchedHits << " batched hits)" << endl;
+    cout << "Contains loop:  " << singleNs / queryCount << " ns/op, "
+         << queryCount / singleNs * 1000.0 << " Mops/s" << endl;
+    cout << "ContainsMany:   " << batchedNs / queryCount << " ns/op, "
+         << queryCount / batchedNs * 1000.0 << " Mops/s" << endl;
+    cout << "speedup:        " << singleNs / batchedNs << "x" << endl;
+    return (mismatches == 0) ? 0 : 1;
+}
@@ -0,0 +1,239 @@
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "RedBlackTree.h"
+#include "CompactRedBlackTree.h"
+#include "BPlusTree.h"
+#include "BucketedRedBlackTree.h"
+#include "ShardedRedBlackTree.h"
+
+/**
+ *
+ * Differential fuzzer and benchmark. A random stream of Insert, Remove,
+ * Contains, GetMin and GetMax calls is run on std::set<int> and on every
+ * int engine. Each engine's result for every call must match std::set's.
+ * Every tenth of the stream its Validate() must pass and its keys must
+ * match; those checks are not timed. The timings show each engine
+ * against std::set on the same calls. The stream has a grow phase
+ * (inserts and lookups) that every engine runs, then a churn phase
+ * (removes too) for the engines that can remove. Exits with 1 at the
+ * first difference, printing the seed and call that show it.
+ *
+ * Usage: ./rbt-fuzz [calls per phase] [key range] [seed]
+ *
+**/
+
+using namespace std;
+
+enum class OpKind { Insert, Remove, Contains, Min, Max };
+
+struct Op {
+    OpKind kind;
+    int key;
+};
+
+// GetMin or GetMax result on an empty engine.
+static const long long EMPTY = LLONG_MIN;
+
+// std::set behind the engine interface, the reference for every result.
+class StdSet {
+
+	public:
+		bool TryInsert(int key) { return keys.insert(key).second; };
+		bool Remove(int key) { return keys.erase(key) == 1; };
+		bool Contains(int key) const { return keys.count(key) == 1; };
+		size_t Size() const { return keys.size(); };
+		int GetMin() const { return *keys.begin(); };
+		int GetMax() const { return *keys.rbegin(); };
+
+		template <class Visitor>
+		void ForEach(Visitor visit) const { for (int key : keys) visit(key); };
+
+	private:
+		set<int> keys;
+};
+
+template <class Tree, class = void>
+struct CanRemove : false_type {};
+template <class Tree>
+struct CanRemove<Tree, void_t<decltype(declval<Tree &>().Remove(0))>> : true_type {};
+
+template <class Tree, class = void>
+struct CanValidate : false_type {};
+template <class Tree>
+struct CanValidate<Tree, void_t<decltype(declval<const Tree &>().Validate())>> : true_type {};
+
+// Makes count calls on keys in [0, range]. Mixes are in percent of
+// insert, remove and contains; the rest are GetMin and GetMax.
+static vector<Op> MakeOps(size_t count, int range, int insertPct, int removePct, int containsPct, mt19937 &gen) {
+    uniform_int_distribution<int> key(0, range);
+    uniform_int_distribution<int> percent(0, 99);
+    vector<Op> ops(count);
+    for (Op &op : ops) {
+        int p = percent(gen);
+        if (p < insertPct) {
+            op.kind = OpKind::Insert;
+        } else if (p < insertPct + removePct) {
+            op.kind = OpKind::Remove;
+        } else if (p < insertPct + removePct + containsPct) {
+            op.kind = OpKind::Contains;
+        } else {
+            op.kind = (p % 2 == 0) ? OpKind::Min : OpKind::Max;
+        }
+        op.key = key(gen);
+    }
+    return ops;
+}
+
+// Runs one call and returns its result as a number.
+template <class Tree>
+static long long Apply(Tree &tree, const Op &op) {
+    switch (op.kind) {
+        case OpKind::Insert:
+            return tree.TryInsert(op.key);
+        case OpKind::Remove:
+            if constexpr (CanRemove<Tree>::value) return tree.Remove(op.key);
+            return 0;
+        case OpKind::Contains:
+            return tree.Contains(op.key);
+        case OpKind::Min:
+            return (tree.Size() == 0) ? EMPTY : tree.GetMin();
+        default:
+            return (tree.Size() == 0) ? EMPTY : tree.GetMax();
+    }
+}
+
+// The reference results and key sets of one phase, every tenth.
+struct Reference {
+    vector<long long> results;
+    vector<vector<int>> keysAt;
+    double seconds = 0;
+};
+
+// Keys of tree in the order ForEach visits them.
+template <class Tree>
+static vector<int> KeysOf(const Tree &tree) {
+    vector<int> keys;
+    keys.reserve(tree.Size());
+    tree.ForEach([&keys](int key) { keys.push_back(key); });
+    return keys;
+}
+
+// Runs ops on tree in ten timed slices. After each slice the engine is
+// validated and its keys compared, untimed, and when reference is being
+// recorded they are stored instead. Returns the time taken, or -1 on the
+// first difference, which is printed.
+template <class Tree>
+static double RunPhase(const char *name, Tree &tree, const vector<Op> &ops, Reference &reference, bool record,
+        unsigned seed) {
+    const size_t slices = 10;
+    vector<long long> results(ops.size());
+    double seconds = 0;
+    for (size_t slice = 0; slice < slices; slice++) {
+        size_t first = ops.size() * slice / slices;
+        size_t last = ops.size() * (slice + 1) / slices;
+        auto start = chrono::steady_clock::now();
+        for (size_t i = first; i < last; i++) {
+            results[i] = Apply(tree, ops[i]);
+        }
+        seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        if (record) {
+            reference.keysAt.push_back(KeysOf(tree));
+            continue;
+        }
+        for (size_t i = first; i < last; i++) {
+            if (results[i] != reference.results[i]) {
+                cerr << name << ": call " << i << " (kind " << static_cast<int>(ops[i].kind) << ", key "
+                     << ops[i].key << ") returned " << results[i] << ", std::set " << reference.results[i]
+                     << "; seed " << seed << endl;
+                return -1;
+            }
+        }
+        if constexpr (CanValidate<Tree>::value) {
+            string problem;
+            if (!tree.Validate(&problem)) {
+                cerr << name << ": Validate failed after call " << last - 1 << ": " << problem << "; seed " << seed << endl;
+                return -1;
+            }
+        }
+        if (KeysOf(tree) != reference.keysAt[slice]) {
+            cerr << name << ": keys differ after call " << last - 1 << "; seed " << seed << endl;
+            return -1;
+        }
+    }
+    if (record) {
+        reference.results = move(results);
+        reference.seconds = seconds;
+    }
+    return seconds;
+}
+
+// Prints one row of the timing table.
+static void Row(const char *name, const char *phase, size_t calls, double seconds, double referenceSeconds, bool validated) {
+    cout << left << setw(22) << name << setw(7) << phase << right << fixed << setprecision(2)
+         << setw(10) << calls / seconds / 1e6 << setw(10) << referenceSeconds / seconds << "x"
+         << (validated ? "   validated" : "") << endl;
+}
+
+// Runs both phases on a fresh engine made by make, the churn phase only
+// if the engine can remove. make returns the engine by value, which needs
+// no copy or move. Returns false on the first difference.
+template <class Tree, class Make>
+static bool RunEngine(const char *name, Make make, const vector<Op> &grow, const vector<Op> &churn,
+        Reference *references, unsigned seed) {
+    Tree tree = make();
+    bool validated = CanValidate<Tree>::value;
+    double seconds = RunPhase(name, tree, grow, references[0], false, seed);
+    if (seconds < 0) return false;
+    Row(name, "grow", grow.size(), seconds, references[0].seconds, validated);
+    if constexpr (CanRemove<Tree>::value) {
+        seconds = RunPhase(name, tree, churn, references[1], false, seed);
+        if (seconds < 0) return false;
+        Row(name, "churn", churn.size(), seconds, references[1].seconds, validated);
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    size_t calls = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 1000000;
+    int range = (argc > 2) ? atoi(argv[2]) : (1 << 20);
+    unsigned seed = (argc > 3) ? static_cast<unsigned>(strtoul(argv[3], nullptr, 10)) : 1;
+    if (range <= 0) range = 1;
+
+    mt19937 gen(seed);
+    vector<Op> grow = MakeOps(calls, range, 50, 0, 40, gen);
+    vector<Op> churn = MakeOps(calls, range, 35, 35, 25, gen);
+
+    Reference references[2];
+    {
+        StdSet reference;
+        RunPhase("std::set", reference, grow, references[0], true, seed);
+        RunPhase("std::set", reference, churn, references[1], true, seed);
+    }
+
+    cout << "calls per phase: " << calls << ", keys in [0, " << range << "], seed " << seed << endl;
+    cout << left << setw(22) << "engine" << setw(7) << "phase" << right << setw(10) << "Mcalls/s"
+         << setw(11) << "vs set" << endl;
+    Row("std::set", "grow", calls, references[0].seconds, references[0].seconds, false);
+    Row("std::set", "churn", calls, references[1].seconds, references[1].seconds, false);
+
+    bool ok = true;
+    ok = ok && RunEngine<RedBlackTree>("RedBlackTree", []() { return RedBlackTree(); }, grow, churn, references, seed);
+    ok = ok && RunEngine<RankedRedBlackTree>("RankedRedBlackTree", []() { return RankedRedBlackTree(); }, grow, churn, references, seed);
+    ok = ok && RunEngine<BucketedRedBlackTree>("BucketedRedBlackTree", []() { return BucketedRedBlackTree(); }, grow, churn, references, seed);
+    ok = ok && RunEngine<CompactRedBlackTree>("CompactRedBlackTree", []() { return CompactRedBlackTree(); }, grow, churn, references, seed);
+    ok = ok && RunEngine<BPlusTree<128>>("BPlusTree<128>", []() { return BPlusTree<128>(); }, grow, churn, references, seed);
+    ok = ok && RunEngine<ShardedRedBlackTree<int>>("ShardedRedBlackTree", [range]() {
+        return ShardedRedBlackTree<int>(ShardedRedBlackTree<int>::EvenBoundaries(64, 0, range));
+    }, grow, churn, references, seed);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,272 @@
+#ifndef FROZENREDBLACKTREE_H
+#define FROZENREDBLACKTREE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "RedBlackTree.h"
+
+using namespace std;
+
+
+template <class Tree>
+class IncrementalFreeze;
+
+
+// FrozenRedBlackTree
+// Immutable, pointer-free copy of a tree made by BasicRedBlackTree::Freeze.
+// The keys are stored in Eytzinger (breadth first) order: the root in slot
+// 1 and the children of slot k in slots 2k and 2k + 1, so a lookup needs no
+// child pointers and the top levels of the tree share a few cache lines.
+// A lookup descends with k = 2k + (key > slot k), which compiles to a
+// conditional move, and prefetches the cache line holding the descendants
+// a few levels down so the next misses are already on their way.
+// See Khuong and Morin, "Array layouts for comparison-based searching"
+// (JEA 2017), which found this beats the van Emde Boas layout for search.
+// Any number of threads may read one frozen tree.
+template <class Key, class Value, class Compare>
+class FrozenRedBlackTree {
+
+	public:
+		FrozenRedBlackTree() = default;
+		FrozenRedBlackTree(const FrozenRedBlackTree &other);
+		FrozenRedBlackTree(FrozenRedBlackTree &&other) noexcept = default;
+		FrozenRedBlackTree &operator=(const FrozenRedBlackTree &other);
+		FrozenRedBlackTree &operator=(FrozenRedBlackTree &&other) noexcept = default;
+
+		bool Contains(const Key &key) const { return Find(key) != 0; };
+		void ContainsMany(const Key *keys, size_t count, bool *found) const;
+		const Value *GetValue(const Key &key) const;
+		size_t Size() const { return numItems; };
+		const Key &GetMin() const;
+		const Key &GetMax() const;
+
+		template <class Visitor>
+		void ForEach(Visitor visit) const;
+
+	private:
+		template <class, class, class, class, bool>
+		friend class BasicRedBlackTree;
+		template <class>
+		friend class IncrementalFreeze;
+
+		static constexpr size_t CACHE_LINE = 64;
+		static constexpr size_t LOOKUP_LANES = 16;
+		static constexpr bool HAS_VALUES = !is_empty<Value>::value;   // NoValue takes no space
+		// Slot k * PREFETCH_STRIDE starts the line of k's descendants
+		// log2(PREFETCH_STRIDE) levels down, four for int keys.
+		static constexpr size_t PREFETCH_STRIDE = (sizeof(Key) < CACHE_LINE) ? CACHE_LINE / sizeof(Key) : 1;
+
+		Compare comp;
+		vector<Key> storage;
+		size_t offset = 0;     // slot 0 lives at storage[offset], on a cache line boundary
+		vector<Value> values;  // by slot, maps only
+		size_t numItems = 0;
+		int levels = 0;
+
+		FrozenRedBlackTree(size_t count, const Compare &comp);
+		void Allocate();
+		Key *Slots() { return storage.data() + offset; };
+		const Key *Slots() const { return storage.data() + offset; };
+		void Place(size_t slot, const Key &key, const Value &value);
+
+		size_t Find(const Key &key) const;
+		size_t First() const;
+		size_t Next(size_t slot) const;
+		static size_t TrailingOnes(size_t slot);
+};
+
+
+#define FRBT_TEMPLATE template <class Key, class Value, class Compare>
+#define FRBT_CLASS FrozenRedBlackTree<Key, Value, Compare>
+
+// Constructor
+// Lays out storage for count keys, to be filled in with Place.
+FRBT_TEMPLATE
+FRBT_CLASS::FrozenRedBlackTree(size_t count, const Compare &comp) : comp(comp), numItems(count) {
+    while (levels < 64 && (size_t(1) << levels) <= count) {
+        levels++;
+    }
+    Allocate();
+    if (HAS_VALUES) values.resize(count + 1);
+}
+
+// Copy Constructor
+// Copies the slots into fresh storage aligned the same way.
+FRBT_TEMPLATE
+FRBT_CLASS::FrozenRedBlackTree(const FrozenRedBlackTree &other)
+    : comp(other.comp), values(other.values), numItems(other.numItems), levels(other.levels) {
+    Allocate();
+    if (numItems > 0) copy(other.Slots(), other.Slots() + numItems + 1, Slots());
+}
+
+// Copy Assignment
+// Copies into a temporary first, so on an exception the tree is unchanged.
+FRBT_TEMPLATE
+FRBT_CLASS &FRBT_CLASS::operator=(const FrozenRedBlackTree &other) {
+    if (this != &other) {
+        FrozenRedBlackTree copy(other);
+        *this = move(copy);
+    }
+    return *this;
+}
+
+// Allocate
+// Sizes storage for slots 0 to numItems with room to slide slot 0 onto a
+// cache line boundary, so every group of descendants the search prefetches
+// sits in one line.
+FRBT_TEMPLATE
+void FRBT_CLASS::Allocate() {
+    storage.clear();
+    offset = 0;
+    if (numItems == 0) return;
+    storage.resize(numItems + 1 + PREFETCH_STRIDE);
+    size_t misalign = reinterpret_cast<uintptr_t>(storage.data()) % CACHE_LINE;
+    if (misalign != 0 && (CACHE_LINE - misalign) % sizeof(Key) == 0) {
+        offset = (CACHE_LINE - misalign) / sizeof(Key);
+    }
+}
+
+// Place
+// Stores one key and its value in a slot.
+FRBT_TEMPLATE
+void FRBT_CLASS::Place(size_t slot, const Key &key, const Value &value) {
+    Slots()[slot] = key;
+    if (HAS_VALUES) values[slot] = value;
+}
+
+// ContainsMany
+// Batched Contains: found[i] is set to whether keys[i] is in the tree.
+// LOOKUP_LANES descents run side by side, one level per round, so their
+// cache misses overlap. Every descent takes levels - 1 or levels steps,
+// so the rounds need no early exit.
+FRBT_TEMPLATE
+void FRBT_CLASS::ContainsMany(const Key *keys, size_t count, bool *found) const {
+    const Key *slots = Slots();
+    size_t cursor[LOOKUP_LANES];
+    for (size_t base = 0; base < count; base += LOOKUP_LANES) {
+        size_t lanes = min(LOOKUP_LANES, count - base);
+        fill(cursor, cursor + lanes, size_t(1));
+        for (int level = 0; level < levels; level++) {
+            for (size_t i = 0; i < lanes; i++) {
+                size_t k = cursor[i];
+                if (k > numItems) continue;
+                RBT_PREFETCH(slots + min(k * PREFETCH_STRIDE, numItems));
+                cursor[i] = 2 * k + comp(slots[k], keys[base + i]);
+            }
+        }
+        for (size_t i = 0; i < lanes; i++) {
+            size_t k = cursor[i] >> (TrailingOnes(cursor[i]) + 1);
+            found[base + i] = (k != 0 && !comp(keys[base + i], slots[k]));
+        }
+    }
+}
+
+// GetValue
+// Returns the value stored under key, or nullptr if the key is not present.
+FRBT_TEMPLATE
+const Value *FRBT_CLASS::GetValue(const Key &key) const {
+    size_t k = Find(key);
+    if (k == 0) return nullptr;
+    if (!HAS_VALUES) {
+        static const Value none{};
+        return &none;
+    }
+    return &values[k];
+}
+
+// GetMin
+// Returns the smallest key. Throws underflow_error if the tree is empty.
+FRBT_TEMPLATE
+const Key &FRBT_CLASS::GetMin() const {
+    if (numItems == 0) throw underflow_error("Tree is empty.");
+    return Slots()[First()];
+}
+
+// GetMax
+// Returns the largest key. Throws underflow_error if the tree is empty.
+FRBT_TEMPLATE
+const Key &FRBT_CLASS::GetMax() const {
+    if (numItems == 0) throw underflow_error("Tree is empty.");
+    size_t k = 1;
+    while (2 * k + 1 <= numItems) k = 2 * k + 1;
+    return Slots()[k];
+}
+
+// ForEach
+// Calls visit(key) in key order.
+FRBT_TEMPLATE
+template <class Visitor>
+void FRBT_CLASS::ForEach(Visitor visit) const {
+    const Key *slots = Slots();
+    for (size_t k = First(); k != 0; k = Next(k)) {
+        visit(slots[k]);
+    }
+}
+
+// Find
+// Returns the slot holding key, or 0 if it is not present. The descent
+// runs off the bottom of the tree; its last left turn was at the smallest
+// key not below key, which is recovered by dropping the right turns taken
+// since then, i.e. the trailing one bits of k, and that left turn itself.
+FRBT_TEMPLATE
+size_t FRBT_CLASS::Find(const Key &key) const {
+    const Key *slots = Slots();
+    size_t k = 1;
+    while (k <= numItems) {
+        RBT_PREFETCH(slots + min(k * PREFETCH_STRIDE, numItems));
+        k = 2 * k + comp(slots[k], key);
+    }
+    k >>= TrailingOnes(k) + 1;
+    return (k != 0 && !comp(key, slots[k])) ? k : 0;
+}
+
+// First
+// Slot of the smallest key, or 0 for an empty tree.
+FRBT_TEMPLATE
+size_t FRBT_CLASS::First() const {
+    if (numItems == 0) return 0;
+    size_t k = 1;
+    while (2 * k <= numItems) k = 2 * k;
+    return k;
+}
+
+// Next
+// Slot of the next key in order, or 0 after the largest. Without a right
+// child the successor is the parent of the nearest ancestor that is a left
+// child, found by the same trailing-ones shift as in Find.
+FRBT_TEMPLATE
+size_t FRBT_CLASS::Next(size_t slot) const {
+    if (2 * slot + 1 <= numItems) {
+        slot = 2 * slot + 1;
+        while (2 * slot <= numItems) slot = 2 * slot;
+        return slot;
+    }
+    return slot >> (TrailingOnes(slot) + 1);
+}
+
+// TrailingOnes
+// Number of consecutive one bits at the bottom of slot.
+FRBT_TEMPLATE
+size_t FRBT_CLASS::TrailingOnes(size_t slot) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<size_t>(__builtin_ctzll(~static_cast<unsigned long long>(slot)));
+#else
+    size_t ones = 0;
+    while (slot & 1) {
+        slot >>= 1;
+        ones++;
+    }
+    return ones;
+#endif
+}
+
+#undef FRBT_CLASS
+#undef FRBT_TEMPLATE
+
+#endif
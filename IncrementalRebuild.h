@@ -0,0 +1,135 @@
+#ifndef INCREMENTALREBUILD_H
+#define INCREMENTALREBUILD_H
+
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include "RedBlackTree.h"
+#include "FrozenRedBlackTree.h"
+
+using namespace std;
+
+
+// IncrementalCopy
+// Copy constructor split into pieces: each Step(budget) clones at most
+// budget more nodes and returns, so a large copy can be spread over many
+// short pauses instead of one long one. Between steps the source keeps
+// answering lookups as usual, but it must not be modified until the copy
+// is Done. The result is the same tree, node for node, that the copy
+// constructor would build. Tree is a BasicRedBlackTree.
+template <class Tree>
+class IncrementalCopy {
+
+	public:
+		explicit IncrementalCopy(const Tree &source);
+
+		bool Step(size_t budget);
+		bool Done() const { return done; };
+		Tree Result();
+
+	private:
+		using Node = typename Tree::Node;
+
+		const Tree *source;
+		Tree copy;
+		const Node *from = nullptr;   // where the walk over the source is
+		Node *to = nullptr;           // from's copy
+		bool done = false;
+};
+
+
+// IncrementalFreeze
+// Freeze split into pieces: each Step(budget) places at most budget more
+// keys into the frozen copy, in order. The frozen storage is allocated up
+// front. As with IncrementalCopy the source must not be modified until the
+// freeze is Done. Tree is a BasicRedBlackTree.
+template <class Tree>
+class IncrementalFreeze {
+
+	public:
+		using Frozen = decltype(declval<const Tree &>().Freeze());
+
+		explicit IncrementalFreeze(const Tree &source);
+
+		bool Step(size_t budget);
+		bool Done() const { return next == last; };
+		Frozen Result();
+
+	private:
+		Frozen frozen;
+		typename Tree::const_iterator next;
+		typename Tree::const_iterator last;
+		size_t slot = 0;
+};
+
+
+// Constructor
+// Sets up an empty copy with the source's ordering and allocator and
+// reserves its pool, so the copy lands in one block like the copy
+// constructor's. Nothing is copied yet.
+template <class Tree>
+IncrementalCopy<Tree>::IncrementalCopy(const Tree &source)
+    : source(&source),
+      copy(source.comp, allocator_traits<typename Tree::allocator_type>::select_on_container_copy_construction(
+          source.pool.GetAllocator())) {
+    copy.pool.Reserve(source.Size());
+    if (source.root == nullptr) {
+        done = true;
+        return;
+    }
+    copy.root = copy.template CloneNode<false>(source.root, nullptr);
+    from = source.root;
+    to = copy.root;
+}
+
+// Step
+// Clones up to budget more nodes. Returns true once the copy is complete.
+// If a key or value copy throws, the nodes copied so far stay owned by the
+// partial copy and go away with this object.
+template <class Tree>
+bool IncrementalCopy<Tree>::Step(size_t budget) {
+    if (done) return true;
+    if (copy.template CopySteps<false>(source->root, from, to, budget)) {
+        copy.ResetEnds();
+        copy.numItems = source->Size();
+        done = true;
+    }
+    return done;
+}
+
+// Result
+// Hands over the finished copy. Throws logic_error if it is not Done yet.
+template <class Tree>
+Tree IncrementalCopy<Tree>::Result() {
+    if (!done) throw logic_error("Copy is not finished.");
+    return move(copy);
+}
+
+// Constructor
+// Allocates the frozen storage for every key of source. Nothing is placed yet.
+template <class Tree>
+IncrementalFreeze<Tree>::IncrementalFreeze(const Tree &source)
+    : frozen(source.Size(), source.GetComparator()), next(source.begin()), last(source.end()) {
+    slot = frozen.First();
+}
+
+// Step
+// Places up to budget more keys. Returns true once every key is in place.
+template <class Tree>
+bool IncrementalFreeze<Tree>::Step(size_t budget) {
+    for (; budget > 0 && next != last; budget--, ++next) {
+        frozen.Place(slot, next.key(), next.value());
+        slot = frozen.Next(slot);
+    }
+    return Done();
+}
+
+// Result
+// Hands over the finished frozen tree. Throws logic_error if it is not Done yet.
+template <class Tree>
+typename IncrementalFreeze<Tree>::Frozen IncrementalFreeze<Tree>::Result() {
+    if (!Done()) throw logic_error("Freeze is not finished.");
+    return move(frozen);
+}
+
+#endif
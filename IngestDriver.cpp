@@ -0,0 +1,71 @@
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include "RedBlackTree.h"
+#include "IntStream.h"
+
+/**
+ *
+ * Streaming driver: loads whitespace separated ints from a file or pipe
+ * into a RedBlackTree, then optionally answers membership queries from
+ * a second input with one "1" or "0" line each on stdout. Keys and
+ * queries go to the tree in batches through InsertMany and ContainsMany.
+ * The time, MB/s and keys/s of every stage (read, parse, insert, query,
+ * write) go to stderr.
+ *
+ * Usage: ./rbt-ingest <keys file|-> [queries file|-] [batch keys]
+ *
+**/
+
+using namespace std;
+
+// Prints one row of the stage report.
+static void Report(const char *stage, const StageStats &stats) {
+    fprintf(stderr, "%-7s %10.3f s %10.1f MB/s %14.0f keys/s %12zu keys\n",
+            stage, stats.seconds, stats.MBPerSecond(), stats.KeysPerSecond(), stats.keys);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2 || argc > 4) {
+        cerr << "Usage: ./rbt-ingest <keys file|-> [queries file|-] [batch keys]" << endl;
+        return 2;
+    }
+    size_t batchKeys = (argc > 3) ? strtoull(argv[3], nullptr, 10) : INGEST_BATCH_KEYS;
+    if (batchKeys == 0) batchKeys = INGEST_BATCH_KEYS;
+
+    try {
+        RedBlackTree tree;
+        auto start = chrono::steady_clock::now();
+        StageStats insertStats;
+        IntReader keys(argv[1]);
+        size_t inserted = IngestInts(tree, keys, insertStats, batchKeys);
+        Report("read", keys.ReadStats());
+        Report("parse", keys.ParseStats());
+        Report("insert", insertStats);
+        fprintf(stderr, "%zu keys inserted, %zu duplicates skipped\n", inserted, insertStats.keys - inserted);
+
+        if (argc > 2) {
+            StageStats queryStats;
+            IntReader queries(argv[2]);
+            OutputBuffer output(STDOUT_FILENO);
+            size_t hits = QueryInts(tree, queries, output, queryStats, batchKeys);
+            output.Flush();
+            StageStats writeStats = output.Stats();
+            writeStats.keys = queryStats.keys;
+            Report("read", queries.ReadStats());
+            Report("parse", queries.ParseStats());
+            Report("query", queryStats);
+            Report("write", writeStats);
+            fprintf(stderr, "%zu of %zu queries found\n", hits, queryStats.keys);
+        }
+        fprintf(stderr, "total   %10.3f s\n", chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    } catch (const exception &e) {
+        cerr << "rbt-ingest: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
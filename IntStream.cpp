@@ -0,0 +1,207 @@
+#include "IntStream.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+// Bytes kept ahead of the parser while more input can follow, enough for
+// any int and the separator after it, so a number is never parsed while
+// its end may still be unread.
+static const size_t LOOKAHEAD_BYTES = 24;
+
+// Seconds
+// Elapsed time since start, for the stage totals.
+static double Seconds(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Constructor
+// Opens path, or takes stdin for "-". Throws runtime_error if it cannot be opened.
+IntReader::IntReader(const string &path, size_t bufferBytes) {
+    if (path == "-") {
+        fd = STDIN_FILENO;
+    } else {
+        fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw runtime_error("Could not open " + path + " for reading.");
+        ownsFd = true;
+    }
+    Open(bufferBytes);
+}
+
+// Constructor that reads from an already open descriptor.
+IntReader::IntReader(int fd, size_t bufferBytes) : fd(fd) {
+    Open(bufferBytes);
+}
+
+// Destructor
+// Unmaps the file, and closes it if this reader opened it.
+IntReader::~IntReader() {
+    if (mapping != nullptr) munmap(mapping, mappingSize);
+    if (ownsFd) close(fd);
+}
+
+// Open
+// Maps a non-empty regular file as one buffer that is entirely read in;
+// for anything else, or if mapping fails, sets up the read buffer.
+void IntReader::Open(size_t bufferBytes) {
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        size_t size = static_cast<size_t>(info.st_size);
+        void *address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address != MAP_FAILED) {
+            madvise(address, size, MADV_SEQUENTIAL);
+            mapping = address;
+            mappingSize = size;
+            pos = static_cast<const char *>(address);
+            end = pos + size;
+            eof = true;
+            return;
+        }
+    }
+    buffer.resize(max(bufferBytes, MIN_BUFFER_BYTES));
+    pos = end = buffer.data();
+}
+
+// ReadBatch
+// Replaces batch with up to maxKeys more ints and returns how many there
+// are, 0 once the input is used up.
+size_t IntReader::ReadBatch(vector<int> &batch, size_t maxKeys) {
+    auto start = chrono::steady_clock::now();
+    double readBefore = readStats.seconds;
+    const char *first = pos;
+    size_t consumed = 0;
+    batch.clear();
+
+    while (batch.size() < maxKeys) {
+        while (pos < end && static_cast<unsigned char>(*pos) <= ' ') {
+            pos++;
+        }
+        if (!eof && static_cast<size_t>(end - pos) < LOOKAHEAD_BYTES) {
+            consumed += pos - first;
+            Refill();
+            first = pos;
+            continue;
+        }
+        if (pos == end) break;
+
+        int value;
+        from_chars_result result = from_chars(pos, end, value);
+        if (result.ptr == end && !eof) {
+            // The number may go on past what has been read, so read more and parse it again
+            consumed += pos - first;
+            Refill();
+            first = pos;
+            continue;
+        }
+        if (result.ec == errc() && (result.ptr == end || static_cast<unsigned char>(*result.ptr) <= ' ')) {
+            batch.push_back(value);
+            pos = result.ptr;
+        } else if (result.ec == errc::result_out_of_range) {
+            throw out_of_range("Integer out of range at byte " + to_string(offset + (pos - first) + consumed) + ".");
+        } else {
+            throw invalid_argument("Not an integer at byte " + to_string(offset + (pos - first) + consumed) + ".");
+        }
+    }
+    consumed += pos - first;
+    offset += consumed;
+    atEnd = batch.empty();
+
+    parseStats.seconds += Seconds(start) - (readStats.seconds - readBefore);
+    parseStats.bytes += consumed;
+    parseStats.keys += batch.size();
+    return batch.size();
+}
+
+// Refill
+// Moves the unparsed tail to the front of the buffer and reads more after
+// it. A tail that fills the whole buffer is one long number, as with zero
+// padding, so the buffer is doubled to make room. Returns false, and marks
+// the input ended, once read() returns 0. Throws runtime_error if reading
+// fails.
+bool IntReader::Refill() {
+    auto start = chrono::steady_clock::now();
+    size_t tail = end - pos;
+    memmove(buffer.data(), pos, tail);
+    if (tail == buffer.size()) buffer.resize(buffer.size() * 2);
+    pos = buffer.data();
+    end = pos + tail;
+    ssize_t got;
+    do {
+        got = read(fd, buffer.data() + tail, buffer.size() - tail);
+    } while (got < 0 && errno == EINTR);
+    readStats.seconds += Seconds(start);
+    if (got < 0) throw runtime_error("Could not read input.");
+    if (got == 0) {
+        eof = true;
+        return false;
+    }
+    end += got;
+    readStats.bytes += static_cast<size_t>(got);
+    return true;
+}
+
+
+// Constructor
+// Writes to fd, which stays open, through a buffer of capacity bytes.
+OutputBuffer::OutputBuffer(int fd, size_t capacity) : fd(fd), buffer(max(capacity, IntReader::MIN_BUFFER_BYTES)) {
+}
+
+// Destructor
+// Writes out whatever is still buffered. A failure here cannot be
+// reported, so call Flush first where it matters.
+OutputBuffer::~OutputBuffer() {
+    try {
+        Flush();
+    } catch (...) {
+    }
+}
+
+// Append
+// Adds value in decimal.
+void OutputBuffer::Append(int value) {
+    Reserve(12);
+    used = to_chars(buffer.data() + used, buffer.data() + buffer.size(), value).ptr - buffer.data();
+}
+
+void OutputBuffer::Append(char c) {
+    Reserve(1);
+    buffer[used++] = c;
+}
+
+void OutputBuffer::Append(const char *text, size_t length) {
+    while (length > 0) {
+        Reserve(1);
+        size_t part = min(length, buffer.size() - used);
+        memcpy(buffer.data() + used, text, part);
+        used += part;
+        text += part;
+        length -= part;
+    }
+}
+
+// Flush
+// Writes out the buffered bytes, retrying short writes, and empties the
+// buffer. Throws runtime_error if a write fails.
+void OutputBuffer::Flush() {
+    auto start = chrono::steady_clock::now();
+    size_t written = 0;
+    while (written < used) {
+        ssize_t put = write(fd, buffer.data() + written, used - written);
+        if (put < 0) {
+            if (errno == EINTR) continue;
+            used = 0;
+            throw runtime_error("Could not write output.");
+        }
+        written += static_cast<size_t>(put);
+    }
+    stats.seconds += Seconds(start);
+    stats.bytes += used;
+    used = 0;
+}
@@ -0,0 +1,154 @@
+#ifndef INTSTREAM_H
+#define INTSTREAM_H
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+
+// StageStats
+// Totals for one stage of an ingest pipeline: the time spent in it and the
+// bytes and keys that went through it.
+struct StageStats {
+	double seconds = 0;
+	size_t bytes = 0;
+	size_t keys = 0;
+
+	double MBPerSecond() const { return (seconds > 0) ? bytes / seconds / 1e6 : 0; };
+	double KeysPerSecond() const { return (seconds > 0) ? keys / seconds : 0; };
+};
+
+
+// IntReader
+// Reads whitespace separated decimal ints from a file, a pipe or stdin in
+// batches, parsing them with from_chars straight out of the I/O buffer.
+// A regular file is mapped and parsed in place with no copy at all;
+// anything else is read through one reusable buffer, with a number cut off
+// at the buffer's end moved to its front before the next read; the buffer
+// doubles if a single number fills it. Throws
+// runtime_error if the input cannot be opened or read, invalid_argument
+// for anything that is not an int, and out_of_range for an int that does
+// not fit.
+class IntReader {
+
+	public:
+		static constexpr size_t BUFFER_BYTES = size_t(1) << 20;
+		static constexpr size_t MIN_BUFFER_BYTES = 32;
+
+		// "-" means stdin.
+		explicit IntReader(const string &path, size_t bufferBytes = BUFFER_BYTES);
+		// Reads from an open descriptor, which stays open.
+		explicit IntReader(int fd, size_t bufferBytes = BUFFER_BYTES);
+		~IntReader();
+
+		IntReader(const IntReader &other) = delete;
+		IntReader &operator=(const IntReader &other) = delete;
+
+		size_t ReadBatch(vector<int> &batch, size_t maxKeys);
+		bool AtEnd() const { return atEnd; };
+
+		// Time blocked in read() calls, and time spent parsing. A mapped
+		// file's pages are read in as the parser touches them, so all of
+		// its time counts as parse time.
+		const StageStats &ReadStats() const { return readStats; };
+		const StageStats &ParseStats() const { return parseStats; };
+
+	private:
+		int fd = -1;
+		bool ownsFd = false;
+		void *mapping = nullptr;
+		size_t mappingSize = 0;
+		vector<char> buffer;
+		const char *pos = nullptr;
+		const char *end = nullptr;
+		bool eof = false;
+		bool atEnd = false;
+		size_t offset = 0;   // input bytes before pos, for error messages
+		StageStats readStats;
+		StageStats parseStats;
+
+		void Open(size_t bufferBytes);
+		bool Refill();
+};
+
+
+// OutputBuffer
+// Reusable buffer in front of a file descriptor. Ints are formatted with
+// to_chars into it and it is written out in one write() call whenever it
+// fills, so a result costs no system call of its own. Throws runtime_error
+// if a write fails.
+class OutputBuffer {
+
+	public:
+		explicit OutputBuffer(int fd, size_t capacity = IntReader::BUFFER_BYTES);
+		~OutputBuffer();
+
+		OutputBuffer(const OutputBuffer &other) = delete;
+		OutputBuffer &operator=(const OutputBuffer &other) = delete;
+
+		void Append(int value);
+		void Append(char c);
+		void Append(const char *text, size_t length);
+		void Flush();
+
+		const StageStats &Stats() const { return stats; };
+
+	private:
+		int fd;
+		vector<char> buffer;
+		size_t used = 0;
+		StageStats stats;
+
+		void Reserve(size_t length) { if (buffer.size() - used < length) Flush(); };
+};
+
+
+static constexpr size_t INGEST_BATCH_KEYS = 65536;
+
+// IngestInts
+// Inserts every int input yields into tree, batchKeys at a time through
+// InsertMany, and adds the insert time and keys to insertStats. Keys the
+// tree already holds are skipped. Returns the number of keys inserted.
+template <class Tree>
+size_t IngestInts(Tree &tree, IntReader &input, StageStats &insertStats, size_t batchKeys = INGEST_BATCH_KEYS) {
+    vector<int> batch;
+    size_t inserted = 0;
+    while (input.ReadBatch(batch, batchKeys) != 0) {
+        auto start = chrono::steady_clock::now();
+        inserted += tree.InsertMany(batch.begin(), batch.end());
+        insertStats.seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        insertStats.bytes += batch.size() * sizeof(int);
+        insertStats.keys += batch.size();
+    }
+    return inserted;
+}
+
+// QueryInts
+// Looks up every int input yields in tree, batchKeys at a time through
+// ContainsMany, and writes "1" or "0" and a newline per query to output.
+// The lookup time goes into queryStats. Returns the number of hits.
+template <class Tree>
+size_t QueryInts(const Tree &tree, IntReader &input, OutputBuffer &output, StageStats &queryStats,
+        size_t batchKeys = INGEST_BATCH_KEYS) {
+    vector<int> batch;
+    unique_ptr<bool[]> found(new bool[batchKeys]);
+    size_t hits = 0;
+    while (size_t count = input.ReadBatch(batch, batchKeys)) {
+        auto start = chrono::steady_clock::now();
+        tree.ContainsMany(batch.data(), count, found.get());
+        queryStats.seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        queryStats.bytes += count * sizeof(int);
+        queryStats.keys += count;
+        for (size_t i = 0; i < count; i++) {
+            hits += found[i];
+            output.Append(found[i] ? "1\n" : "0\n", 2);
+        }
+    }
+    return hits;
+}
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef KEYSEARCH_H
+#define KEYSEARCH_H
+
+#include <cstddef>
+#include <cstdint>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+
+// CountLessInt32
+// Returns how many of keys[0..count) are smaller than key, which for sorted
+// keys is the position key would be inserted at. All Lanes entries are
+// compared with no branch, eight per AVX2 or four per SSE2 instruction
+// (plain loops elsewhere), and the bits for the entries past count are
+// masked off before counting, so the entries past count must be readable
+// but may hold anything. The loads need no alignment.
+template <size_t Lanes>
+inline uint32_t CountLessInt32(const int32_t *keys, uint32_t count, int32_t key) {
+	static_assert(Lanes % 8 == 0 && Lanes <= 32, "Scan whole vectors of one mask word");
+#if defined(__AVX2__)
+	__m256i probe = _mm256_set1_epi32(key);
+	uint32_t less = 0;
+	for (size_t i = 0; i < Lanes; i += 8) {
+		__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + i));
+		uint32_t bits = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(probe, block))));
+		less |= bits << i;
+	}
+	less &= static_cast<uint32_t>((uint64_t(1) << count) - 1);
+	return static_cast<uint32_t>(__builtin_popcount(less));
+#elif defined(__SSE2__)
+	__m128i probe = _mm_set1_epi32(key);
+	uint32_t less = 0;
+	for (size_t i = 0; i < Lanes; i += 4) {
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys + i));
+		uint32_t bits = static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(probe, block))));
+		less |= bits << i;
+	}
+	less &= static_cast<uint32_t>((uint64_t(1) << count) - 1);
+	return static_cast<uint32_t>(__builtin_popcount(less));
+#else
+	uint32_t less = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		less += (keys[i] < key);
+	}
+	return less;
+#endif
+}
+
+#endif
@@ -0,0 +1,193 @@
+#ifndef MAPPEDREDBLACKTREE_H
+#define MAPPEDREDBLACKTREE_H
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include "RedBlackTree.h"
+#include "TreeFile.h"
+
+using namespace std;
+
+
+// MappedRedBlackTree
+// Read-only tree queried straight out of a file written by
+// BasicRedBlackTree::Save, with nothing deserialized: opening it maps the
+// file and checks the header, and pages are read in only as lookups touch
+// them. A lookup is a binary search of the in-order keys, the implicit form
+// of the balanced tree Load would build from them. The file must have been
+// saved under the same ordering; its keys are trusted and not checked. Any
+// number of threads may query one tree.
+template <class Key, class Value = NoValue, class Compare = less<Key>>
+class MappedRedBlackTree {
+
+	public:
+		explicit MappedRedBlackTree(const string &path, const Compare &comp = Compare());
+		~MappedRedBlackTree() { Unmap(); };
+
+		MappedRedBlackTree(const MappedRedBlackTree &other) = delete;
+		MappedRedBlackTree &operator=(const MappedRedBlackTree &other) = delete;
+		MappedRedBlackTree(MappedRedBlackTree &&other) noexcept;
+		MappedRedBlackTree &operator=(MappedRedBlackTree &&other) noexcept;
+
+		bool Contains(const Key &key) const { return Find(key) != count; };
+		const Value *GetValue(const Key &key) const;
+		size_t Size() const { return count; };
+		const Key &GetMin() const;
+		const Key &GetMax() const;
+
+		// The keys in order, for scans and the standard range algorithms.
+		const Key *begin() const { return keys; };
+		const Key *end() const { return keys + count; };
+
+	private:
+		using Layout = TreeFileLayout<Key, Value>;
+
+		Compare comp;
+		void *mapping = nullptr;
+		size_t mappingSize = 0;
+		const Key *keys = nullptr;
+		const Value *values = nullptr;
+		size_t count = 0;
+
+		size_t Find(const Key &key) const;
+		void Unmap();
+};
+
+
+#define MRBT_TEMPLATE template <class Key, class Value, class Compare>
+#define MRBT_CLASS MappedRedBlackTree<Key, Value, Compare>
+
+// Constructor
+// Maps the file at path read-only. Throws runtime_error if it cannot be
+// opened or mapped, and invalid_argument if it does not hold a tree of this
+// Key and Value.
+MRBT_TEMPLATE
+MRBT_CLASS::MappedRedBlackTree(const string &path, const Compare &comp) : comp(comp) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw runtime_error("Could not open " + path + " for reading.");
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        throw runtime_error("Could not read " + path + ".");
+    }
+    size_t fileSize = static_cast<size_t>(info.st_size);
+    if (fileSize < sizeof(RBTFileHeader)) {
+        close(fd);
+        throw invalid_argument("Not a tree file.");
+    }
+    void *address = mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED) throw runtime_error("Could not map " + path + ".");
+    mapping = address;
+    mappingSize = fileSize;
+
+    const RBTFileHeader &header = *static_cast<const RBTFileHeader *>(address);
+    try {
+        Layout::Check(header, fileSize);
+    } catch (...) {
+        Unmap();
+        throw;
+    }
+    const char *bytes = static_cast<const char *>(address);
+    count = header.count;
+    keys = reinterpret_cast<const Key *>(bytes + Layout::KeysOffset());
+    if (Layout::HAS_VALUES) values = reinterpret_cast<const Value *>(bytes + Layout::ValuesOffset(count));
+}
+
+// Move Constructor
+// Takes over other's mapping, leaving it empty.
+MRBT_TEMPLATE
+MRBT_CLASS::MappedRedBlackTree(MappedRedBlackTree &&other) noexcept
+    : comp(other.comp), mapping(other.mapping), mappingSize(other.mappingSize),
+      keys(other.keys), values(other.values), count(other.count) {
+    other.mapping = nullptr;
+    other.keys = nullptr;
+    other.values = nullptr;
+    other.count = 0;
+}
+
+// Move Assignment
+// Unmaps this tree's file and takes over other's mapping, leaving it empty.
+MRBT_TEMPLATE
+MRBT_CLASS &MRBT_CLASS::operator=(MappedRedBlackTree &&other) noexcept {
+    if (this != &other) {
+        Unmap();
+        comp = other.comp;
+        mapping = other.mapping;
+        mappingSize = other.mappingSize;
+        keys = other.keys;
+        values = other.values;
+        count = other.count;
+        other.mapping = nullptr;
+        other.keys = nullptr;
+        other.values = nullptr;
+        other.count = 0;
+    }
+    return *this;
+}
+
+// GetValue
+// Returns the value stored under key, or nullptr if the key is not present.
+// The pointer points into the mapping and lives as long as the tree.
+MRBT_TEMPLATE
+const Value *MRBT_CLASS::GetValue(const Key &key) const {
+    size_t i = Find(key);
+    if (i == count) return nullptr;
+    if (values == nullptr) {
+        static const Value none{};
+        return &none;
+    }
+    return values + i;
+}
+
+// GetMin
+// Returns the smallest key. Throws underflow_error if the tree is empty.
+MRBT_TEMPLATE
+const Key &MRBT_CLASS::GetMin() const {
+    if (count == 0) throw underflow_error("Tree is empty.");
+    return keys[0];
+}
+
+// GetMax
+// Returns the largest key. Throws underflow_error if the tree is empty.
+MRBT_TEMPLATE
+const Key &MRBT_CLASS::GetMax() const {
+    if (count == 0) throw underflow_error("Tree is empty.");
+    return keys[count - 1];
+}
+
+// Find
+// Returns the position of key in the file, or count if it is not there.
+// Halving the range with a conditional move instead of a branch keeps the
+// search from mispredicting on every level.
+MRBT_TEMPLATE
+size_t MRBT_CLASS::Find(const Key &key) const {
+    if (count == 0) return count;
+    const Key *base = keys;
+    size_t size = count;
+    while (size > 1) {
+        size_t half = size / 2;
+        base = comp(base[half], key) ? base + half : base;
+        size -= half;
+    }
+    base += comp(*base, key);
+    return (base != keys + count && !comp(key, *base)) ? static_cast<size_t>(base - keys) : count;
+}
+
+// Unmap
+// Releases the mapping, if there is one.
+MRBT_TEMPLATE
+void MRBT_CLASS::Unmap() {
+    if (mapping != nullptr) munmap(mapping, mappingSize);
+    mapping = nullptr;
+}
+
+#undef MRBT_CLASS
+#undef MRBT_TEMPLATE
+
+#endif
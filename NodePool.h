@@ -0,0 +1,370 @@
+#ifndef NODEPOOL_H
+#define NODEPOOL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+
+// NodePool
+// Slab allocator for tree nodes. Nodes are carved out of large contiguous
+// blocks obtained from Alloc instead of one heap call per node, destroyed
+// nodes go onto a free list for reuse, and all blocks are handed back at
+// once when the pool dies. Clear() does not run node destructors; the owner
+// must Destroy() live nodes first if Node is not trivially destructible.
+// After Share, two pools hold the same blocks, which are handed back once
+// neither needs them.
+template <class Node, class Alloc = allocator<Node>>
+class NodePool {
+
+	public:
+		using allocator_type = typename allocator_traits<Alloc>::template rebind_alloc<Node>;
+
+		NodePool() = default;
+		explicit NodePool(const allocator_type &alloc) : alloc(alloc) {};
+		~NodePool() { Clear(); };
+
+		NodePool(const NodePool &other) = delete;
+		NodePool &operator=(const NodePool &other) = delete;
+		NodePool(NodePool &&other) noexcept : alloc(move(other.alloc)) { SwapStorage(other); };
+		NodePool &operator=(NodePool &&other) = delete;
+
+		void Swap(NodePool &other) noexcept;
+		void TakeFrom(NodePool &other) noexcept;
+		void Splice(NodePool &other);
+		void Share(NodePool &other);
+
+		template <class... Args>
+		Node *Create(Args &&... args);
+		void Destroy(Node *node);
+
+		void Reserve(size_t count);
+		Node *TakeBlock(size_t count);
+		void Clear();
+		void Recycle() noexcept;
+
+		size_t Capacity() const { return capacity; };
+		allocator_type GetAllocator() const { return alloc; };
+
+	private:
+		static constexpr size_t MIN_BLOCK_NODES = 64;
+		static constexpr size_t MAX_BLOCK_NODES = 65536;
+		// A memory_resource may do nothing on deallocate, as monotonic_buffer_resource
+		// and PageArenaResource do, so Recycle only merges blocks for other allocators.
+		static constexpr bool MERGE_ON_RECYCLE = !is_same<allocator_type, pmr::polymorphic_allocator<Node>>::value;
+
+		// A destroyed node's storage is reused to hold the free list link.
+		struct FreeSlot {
+			FreeSlot *next;
+		};
+		static_assert(sizeof(Node) >= sizeof(FreeSlot), "Node too small for the free list");
+
+		struct Block {
+			Node *nodes;
+			size_t count;
+		};
+
+		// Blocks held by every pool they were shared with. The last pool to
+		// let go hands them back to the allocator.
+		struct SharedBlocks {
+			allocator_type alloc;
+			vector<Block> blocks;
+			size_t capacity = 0;
+
+			explicit SharedBlocks(const allocator_type &alloc) : alloc(alloc) {};
+			~SharedBlocks();
+		};
+
+		allocator_type alloc;
+		vector<Block> blocks;
+		vector<shared_ptr<SharedBlocks>> shared;
+		FreeSlot *freeList = nullptr;
+		Node *nextFree = nullptr;   // bump pointer into the newest block
+		Node *blockEnd = nullptr;
+		size_t nextBlockNodes = MIN_BLOCK_NODES;
+		size_t capacity = 0;
+
+		Node *TakeSlot();
+		void PushFree(Node *slot);
+		void AddBlock(size_t count);
+		void AddShared(const shared_ptr<SharedBlocks> &held);
+		void SwapStorage(NodePool &other) noexcept;
+};
+
+
+// Create
+// Constructs a node from args in a recycled slot if there is one, otherwise
+// in fresh block storage.
+template <class Node, class Alloc>
+template <class... Args>
+Node *NodePool<Node, Alloc>::Create(Args &&... args) {
+	Node *slot = TakeSlot();
+	try {
+		return new (slot) Node(forward<Args>(args)...);
+	} catch (...) {
+		PushFree(slot);
+		throw;
+	}
+}
+
+// Destroy
+// Runs the node's destructor and puts its storage back on the free list.
+template <class Node, class Alloc>
+void NodePool<Node, Alloc>::Destroy(Node *node) {
+	node->~Node();
+	PushFree(node);
+}
+
+// Swap
+// Exchanges all blocks with another pool. Allocators are only exchanged when
+// they propagate on swap; otherwise they must compare equal, as for the
+// standard containers.
+template <class Node, class Alloc>
+void NodePool<Node, Alloc>::Swap(NodePool &other) noexcept {
+	if constexpr (allocator_traits<allocator_type>::propagate_on_container_swap::value) {
+		swap(alloc, other.alloc);
+	}
+	SwapStorage(other);
+}
+
+// TakeFrom
+// Releases this pool's blocks and takes over another pool's, leaving it empty.
+// Without a propagating allocator the two allocators must compare equal.
+template <class Node, class Alloc>
+void NodePool<Node, Alloc>::TakeFrom(NodePool &other) noexcept {
+	Clear();
+	if constexpr (allocator_traits<allocator_type>::propagate_on_container_move_assignment::value) {
+		alloc = move(other.alloc);
+	}
+	SwapStorage(other);
+}
+
+// Splice
+// Takes over another pool's blocks and free slots, leaving it empty, so the
+// nodes it handed out now belong to this pool. The allocators must compare
+// equal. The smaller of the two unused bump regions goes onto the free list.
+// Blocks both pools share are only counted once.
+template <class Node, class Alloc>
+void NodePool<Node, Alloc>::Splice(NodePool &other) {
+	shared.reserve(shared.size() + other.shared.size());
+	blocks.insert(blocks.end(), other.blocks.begin(), other.blocks.end());
+	other.blocks.clear();
+	for (const shared_ptr<SharedBlocks> &held : other.shared) {
+		other.capacity -= held->capacity;
+		AddShared(held);
+	}
+	other.shared.clear();
+	if (other.blockEnd - other.nextFree > blockEnd - nextFree) {
+		swap(nextFree, other.nextFree);
+		swap(blockEnd, other.blockEnd);
+	}
+	for (Node *slot = other.nextFree; slot != other.blockEnd; ++slot) {
+		PushFree(slot);
+	}
+	while (other.freeList != nullptr) {
+		FreeSlot *link = other.freeList;
+		other.freeList = link->next;
+		link->next = freeList;
+		freeList = link;
+	}
+	capacity += other.capacity;
+	nextBlockNodes = max(nextBlockNodes, other.nextBlockNodes);
+	other.nextFree = nullptr;
+	other.blockEnd = nullptr;
+	other.nextBlockNodes = MIN_BLOCK_NODES;
+	other.capacity = 0;
+}
+
+// Share
+// Gives other a hold on every block of this pool, so nodes this pool handed
+// out can be passed to other's owner without being copied. Whichever pool
+// then destroys such a node puts its slot on its own free list; the pools
+// keep separate free lists and bump regions, so each can still be used from
+// its own thread. The blocks go back to the allocator when both pools have
+// released them, and both count them in Capacity(). The allocators must
+// compare equal.
+template <class Node, class Alloc>
+void NodePool<Node, Alloc>::Share(NodePool &other) {
+	if (!blocks.empty()) {
+		shared.reserve(shared.size() + 1);
+		shared_ptr<SharedBlocks> moved = make_shared<SharedBlocks>(alloc);
+		moved->blocks.swap(blocks);
+		for (const Block &block : moved->blocks) {
+			moved->capacity += block.count;
+		}
+		shared.push_back(move(moved));
+	}
+	other.shared.reserve(other.shared.size() + shared.size());
+	for (const shared_ptr<SharedBlocks> &held : shared) {
+		other.AddShared(held);
+	}
+}
+
+// Reserve
+// Makes sure the next count allocations need no new block, adding one block
+// of count nodes if the bump region is shorter. The old region's unused
+// tail goes onto the free list, as in Splice, so none of it is lost.
+template <class Node, class Alloc>
+void NodePool<Node, Alloc>::Reserve(size_t count) {
+	if (static_cast<size_t>(blockEnd - nextFree) < count) {
+		Node *tail = nextFree;
+		Node *tailEnd = blockEnd;
+		AddBlock(count);
+		for (Node *slot = tail; slot != tailEnd; ++slot) {
+			PushFree(slot);
+		}
+	}
+}
+
+// TakeBlock
+// Hands out uninitialized storage for count nodes in one contiguous run. The
+// caller must construct a node in every slot, and may do so from several
+// threads since the pool is not touched again.
+template <class Node, class Alloc>
+Node *NodePool<Node, Alloc>::TakeBlock(size_t count) {
+	Reserve(count);
+	Node *slots = nextFree;
+	nextFree += count;
+	return slots;
+}
+
+// Clear
+// Releases every block in one pass. Any node still in use becomes invalid.
+template <class Node, class Alloc>
+void NodePool<Node, Alloc>::Clear() {
+	for (const Block &block : blocks) {
+		allocator_traits<allocator_type>::deallocate(alloc, block.nodes, block.count);
+	}
+	blocks.clear();
+	shared.clear();
+	freeList = nullptr;
+	nextFree = nullptr;
+	blockEnd = nullptr;
+	nextBlockNodes = MIN_BLOCK_NODES;
+	capacity = 0;
+}
+
+// Recycle
+// Forgets every node but keeps the storage for reuse. Several blocks are
+// merged into one of the same total size, so later allocations are a plain
+// bump through contiguous memory; a tree that is refilled to the same size
+// every time then makes no allocator calls after the first Recycle. Shared
+// blocks may still hold another pool's nodes, so they are released and
+// replaced the same way. If the merged block cannot be allocated the pool
+// is simply left empty. Like Clear, no node destructors run.
+// With a polymorphic_allocator the resource may never take memory back,
+// and merging would request the whole capacity again on every Recycle,
+// growing without bound in a refill loop. Such pools keep their own
+// blocks as they are instead: the newest becomes the bump region and the
+// others go onto the free list. Shared blocks are only let go.
+template <class Node, class Alloc>
+void NodePool<Node, Alloc>::Recycle() noexcept {
+	size_t total = capacity;
+	size_t growth = nextBlockNodes;
+	if (!MERGE_ON_RECYCLE) {
+		for (const shared_ptr<SharedBlocks> &held : shared) {
+			capacity -= held->capacity;
+		}
+		shared.clear();
+		freeList = nullptr;
+		nextFree = blockEnd = nullptr;
+		for (size_t i = 0; i + 1 < blocks.size(); i++) {
+			for (Node *slot = blocks[i].nodes; slot != blocks[i].nodes + blocks[i].count; ++slot) {
+				PushFree(slot);
+			}
+		}
+		if (!blocks.empty()) {
+			nextFree = blocks.back().nodes;
+			blockEnd = nextFree + blocks.back().count;
+		}
+	} else if (blocks.size() > 1 || !shared.empty()) {
+		Clear();
+		try {
+			AddBlock(total);
+		} catch (...) {
+			return;
+		}
+		nextBlockNodes = growth;
+	} else if (!blocks.empty()) {
+		nextFree = blocks[0].nodes;
+		blockEnd = blocks[0].nodes + blocks[0].count;
+		freeList = nullptr;
+	}
+}
+
+// TakeSlot
+// Returns uninitialized storage for one node, preferring the free list.
+template <class Node, class Alloc>
+Node *NodePool<Node, Alloc>::TakeSlot() {
+	if (freeList != nullptr) {
+		FreeSlot *slot = freeList;
+		freeList = slot->next;
+		return reinterpret_cast<Node *>(slot);
+	}
+	if (nextFree == blockEnd) {
+		AddBlock(nextBlockNodes);
+		if (nextBlockNodes < MAX_BLOCK_NODES) nextBlockNodes *= 2;
+	}
+	return nextFree++;
+}
+
+// PushFree
+// Puts one slot of uninitialized storage on the free list.
+template <class Node, class Alloc>
+void NodePool<Node, Alloc>::PushFree(Node *slot) {
+	FreeSlot *link = new (static_cast<void *>(slot)) FreeSlot;
+	link->next = freeList;
+	freeList = link;
+}
+
+// SwapStorage
+// Exchanges the blocks and free list, but not the allocator.
+template <class Node, class Alloc>
+void NodePool<Node, Alloc>::SwapStorage(NodePool &other) noexcept {
+	blocks.swap(other.blocks);
+	shared.swap(other.shared);
+	swap(freeList, other.freeList);
+	swap(nextFree, other.nextFree);
+	swap(blockEnd, other.blockEnd);
+	swap(nextBlockNodes, other.nextBlockNodes);
+	swap(capacity, other.capacity);
+}
+
+// AddBlock
+// Grabs a new block from the allocator and makes it the bump region.
+template <class Node, class Alloc>
+void NodePool<Node, Alloc>::AddBlock(size_t count) {
+	blocks.reserve(blocks.size() + 1);
+	Node *nodes = allocator_traits<allocator_type>::allocate(alloc, count);
+	blocks.push_back(Block{nodes, count});
+	nextFree = nodes;
+	blockEnd = nodes + count;
+	capacity += count;
+}
+
+// AddShared
+// Holds on to a set of shared blocks unless this pool already does. The
+// caller must have reserved room in shared.
+template <class Node, class Alloc>
+void NodePool<Node, Alloc>::AddShared(const shared_ptr<SharedBlocks> &held) {
+	if (find(shared.begin(), shared.end(), held) != shared.end()) return;
+	shared.push_back(held);
+	capacity += held->capacity;
+}
+
+// SharedBlocks Destructor
+// Hands the blocks back once the last pool holding them is done.
+template <class Node, class Alloc>
+NodePool<Node, Alloc>::SharedBlocks::~SharedBlocks() {
+	for (const Block &block : blocks) {
+		allocator_traits<allocator_type>::deallocate(alloc, block.nodes, block.count);
+	}
+}
+
+#endif
@@ -0,0 +1,111 @@
+#include "PageArena.h"
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#endif
+
+using namespace std;
+
+// Constructor
+// Keeps the options; nothing is mapped until the first allocation.
+// Throws invalid_argument for a NUMA node the node mask cannot express.
+PageArenaResource::PageArenaResource(const PageArenaOptions &options) : options(options) {
+    if (options.numaNode < -1 || options.numaNode >= 64) {
+        throw invalid_argument("NUMA node must be -1 or below 64.");
+    }
+    if (this->options.chunkBytes == 0) this->options.chunkBytes = HUGE_PAGE_BYTES;
+}
+
+// Release
+// Unmaps every chunk at once. Memory handed out before becomes invalid.
+void PageArenaResource::Release() {
+    for (const Chunk &chunk : chunks) {
+        munmap(chunk.base, chunk.bytes);
+    }
+    chunks.clear();
+    next = nullptr;
+    end = nullptr;
+    bytesMapped = 0;
+    bytesUsed = 0;
+}
+
+// do_allocate
+// Carves bytes out of the current chunk, mapping a new one when it does
+// not fit. The rest of the old chunk is left unused. Throws bad_alloc if
+// the kernel refuses the mapping.
+void *PageArenaResource::do_allocate(size_t bytes, size_t alignment) {
+    uintptr_t start = (reinterpret_cast<uintptr_t>(next) + alignment - 1) & ~(uintptr_t(alignment) - 1);
+    if (next == nullptr || start + bytes > reinterpret_cast<uintptr_t>(end)) {
+        MapChunk(bytes + alignment);
+        start = (reinterpret_cast<uintptr_t>(next) + alignment - 1) & ~(uintptr_t(alignment) - 1);
+    }
+    next = reinterpret_cast<char *>(start + bytes);
+    bytesUsed += bytes;
+    return reinterpret_cast<void *>(start);
+}
+
+// MapChunk
+// Maps a chunk of at least minBytes, a whole number of huge pages starting
+// on a huge page boundary, and makes it the bump region. Ordinary mappings
+// are only page aligned, so one extra huge page is mapped and the ends
+// beyond the aligned part are unmapped again. The page and NUMA advice is
+// given before anything touches the chunk, so the first faults already
+// follow it.
+void PageArenaResource::MapChunk(size_t minBytes) {
+    size_t bytes = max(options.chunkBytes, minBytes);
+    bytes = (bytes + HUGE_PAGE_BYTES - 1) / HUGE_PAGE_BYTES * HUGE_PAGE_BYTES;
+
+    char *base = nullptr;
+#ifdef MAP_HUGETLB
+    if (options.explicitHugePages) {
+        void *address = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (address != MAP_FAILED) {
+            base = static_cast<char *>(address);
+        } else {
+            placementHonored = false;
+        }
+    }
+#else
+    if (options.explicitHugePages) placementHonored = false;
+#endif
+    if (base == nullptr) {
+        size_t padded = bytes + HUGE_PAGE_BYTES;
+        void *address = mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (address == MAP_FAILED) throw bad_alloc();
+        char *raw = static_cast<char *>(address);
+        base = reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(raw) + HUGE_PAGE_BYTES - 1) & ~(uintptr_t(HUGE_PAGE_BYTES) - 1));
+        if (base != raw) munmap(raw, base - raw);
+        if (raw + padded != base + bytes) munmap(base + bytes, raw + padded - (base + bytes));
+#ifdef MADV_HUGEPAGE
+        if (options.hugePages) madvise(base, bytes, MADV_HUGEPAGE);
+#endif
+    }
+
+    if (options.numaNode >= 0) {
+#ifdef __linux__
+        unsigned long mask = 1UL << options.numaNode;
+        // The kernel reads maxnode - 1 bits of the mask
+        if (syscall(SYS_mbind, base, bytes, MPOL_PREFERRED, &mask, sizeof(mask) * 8 + 1, 0) != 0) {
+            placementHonored = false;
+        }
+#else
+        placementHonored = false;
+#endif
+    }
+
+    try {
+        chunks.push_back(Chunk{base, bytes});
+    } catch (...) {
+        munmap(base, bytes);
+        throw;
+    }
+    next = base;
+    end = base + bytes;
+    bytesMapped += bytes;
+}
@@ -0,0 +1,78 @@
+#ifndef PAGEARENA_H
+#define PAGEARENA_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+using namespace std;
+
+
+// PageArenaOptions
+// How a PageArenaResource maps its chunks. chunkBytes is rounded up to
+// whole huge pages. hugePages asks for transparent huge pages with
+// madvise; explicitHugePages first tries the kernel's reserved huge page
+// pool (MAP_HUGETLB) and falls back to ordinary pages when it is empty.
+// numaNode, when not -1, makes every chunk prefer that NUMA node's memory.
+struct PageArenaOptions {
+	size_t chunkBytes = size_t(32) << 20;
+	bool hugePages = true;
+	bool explicitHugePages = false;
+	int numaNode = -1;
+};
+
+
+// PageArenaResource
+// memory_resource that hands out memory from large anonymous mappings
+// aligned to 2MB huge pages, for trees whose nodes should sit on few TLB
+// entries or on the NUMA node of the threads that read them. Pass it to a
+// PmrRedBlackTree; the tree's pool takes its node blocks from here, so the
+// arena sees a handful of large requests rather than one per node.
+// Like monotonic_buffer_resource, deallocation is a no-op and the memory
+// goes back only by Release() or when the arena dies, which must not
+// happen before the trees using it are gone. A tree's Clear() therefore
+// reuses its pool's blocks in place rather than merging them (see
+// NodePool::Recycle), but a tree destroyed or rebuilt from scratch leaves
+// its blocks used up in the arena. Not thread-safe: trees sharing an
+// arena must not allocate at the same time.
+class PageArenaResource : public pmr::memory_resource {
+
+	public:
+		static const size_t HUGE_PAGE_BYTES = size_t(2) << 20;
+
+		explicit PageArenaResource(const PageArenaOptions &options = PageArenaOptions());
+		~PageArenaResource() { Release(); };
+
+		PageArenaResource(const PageArenaResource &other) = delete;
+		PageArenaResource &operator=(const PageArenaResource &other) = delete;
+
+		void Release();
+
+		size_t BytesMapped() const { return bytesMapped; };
+		size_t BytesUsed() const { return bytesUsed; };
+		// False once a chunk could not be placed as requested: no huge pages
+		// from the reserved pool, or the NUMA node was refused.
+		bool PlacementHonored() const { return placementHonored; };
+
+	private:
+		struct Chunk {
+			char *base;
+			size_t bytes;
+		};
+
+		PageArenaOptions options;
+		vector<Chunk> chunks;
+		char *next = nullptr;
+		char *end = nullptr;
+		size_t bytesMapped = 0;
+		size_t bytesUsed = 0;
+		bool placementHonored = true;
+
+		void *do_allocate(size_t bytes, size_t alignment) override;
+		void do_deallocate(void * /*p*/, size_t /*bytes*/, size_t /*alignment*/) override {};
+		bool do_is_equal(const pmr::memory_resource &other) const noexcept override { return this == &other; };
+
+		void MapChunk(size_t minBytes);
+};
+
+#endif
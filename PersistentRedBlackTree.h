@@ -0,0 +1,615 @@
+#ifndef PERSISTENTREDBLACKTREE_H
+#define PERSISTENTREDBLACKTREE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "RedBlackTree.h"
+
+using namespace std;
+
+
+// PathCopyNode
+// Node of the path copying trees. Once a write has finished a node is never
+// changed again, so any number of tree versions can share it. refs counts
+// the parents and tree handles pointing at it; trees that reclaim nodes some
+// other way leave it alone.
+template <class Key, class Value>
+struct PathCopyNode {
+	PathCopyNode(const Key &data, const Value &value, unsigned short int color,
+	             PathCopyNode *left, PathCopyNode *right, uint64_t stamp)
+		: data(data), value(value), color(color), left(left), right(right), stamp(stamp) {};
+
+	Key data;
+	Value value;
+	unsigned short int color;
+	atomic<uint32_t> refs{0};
+	PathCopyNode *left;
+	PathCopyNode *right;
+	uint64_t stamp;   // the write that created the node
+};
+
+
+// PathCopier
+// One write against an immutable tree, using the functional insert and
+// delete of Kahrs, "Red-black trees with types" (JFP 2001). Nodes made by
+// this write are changed in place; every other node on the way is rebuilt
+// as a copy and the original left as it is, so older versions stay intact.
+// Each write draws a stamp no other write has used, which is what tells its
+// nodes apart. Originals the new version no longer uses are appended to
+// replaced when it is given. Unless the caller calls Keep once the new
+// version is built, the destructor frees every node the write created and
+// takes its entries back off replaced, so a write that throws part way
+// leaves nothing behind.
+template <class Key, class Value, class Compare>
+class PathCopier {
+
+	public:
+		using Node = PathCopyNode<Key, Value>;
+
+		PathCopier(const Compare &comp, vector<Node *> *replaced);
+		~PathCopier();
+
+		PathCopier(const PathCopier &other) = delete;
+		PathCopier &operator=(const PathCopier &other) = delete;
+
+		Node *Insert(Node *top, const Key &key, const Value &value);
+		Node *Remove(Node *top, const Key &key);
+		void Keep() { kept = true; };
+
+		bool IsFresh(const Node *n) const { return n->stamp == stamp; };
+		// Every node this write created that the new version still uses.
+		const vector<Node *> &Created() const { return created; };
+
+		static const Node *Get(const Node *n, const Key &key, const Compare &comp);
+
+	private:
+		const Compare &comp;
+		vector<Node *> *replaced;
+		size_t replacedBefore;
+		vector<Node *> created;
+		uint64_t stamp;
+		bool kept = false;
+
+		static bool IsRed(const Node *n) { return n != nullptr && n->color == COLOR_RED; };
+		static bool IsBlackNode(const Node *n) { return n != nullptr && n->color == COLOR_BLACK; };
+		static uint64_t NextStamp();
+
+		Node *Create(const Key &key, const Value &value, unsigned short int color, Node *left, Node *right);
+		Node *Rebuild(Node *n, unsigned short int color, Node *left, Node *right);
+		void Retire(Node *n);
+		Node *Blacken(Node *n);
+
+		Node *Balance(Node *left, Node *middle, Node *right);
+		Node *BalanceLeft(Node *left, Node *middle, Node *right);
+		Node *BalanceRight(Node *left, Node *middle, Node *right);
+		Node *Combine(Node *left, Node *right);
+		Node *InsertBelow(Node *n, const Key &key, const Value &value);
+		Node *RemoveBelow(Node *n, const Key &key);
+};
+
+
+// PersistentRedBlackTree
+// Ordered set or map whose copies share structure. Copying a tree, or taking
+// a Snapshot(), costs O(1): both handles point at the same root, and a later
+// write to either copies only the O(log n) path it changes. Nodes are
+// reference counted and freed when the last version using them goes away.
+// The counts are atomic, so handles sharing nodes may be read, written and
+// destroyed on different threads, e.g. a writer handing snapshots to
+// long-lived readers. A single handle is not safe for concurrent writes.
+template <class Key, class Value = NoValue, class Compare = less<Key>>
+class PersistentRedBlackTree {
+
+	public:
+		PersistentRedBlackTree() = default;
+		explicit PersistentRedBlackTree(const Compare &comp) : comp(comp) {};
+		~PersistentRedBlackTree() { Release(root); };
+
+		PersistentRedBlackTree(const PersistentRedBlackTree &other);
+		PersistentRedBlackTree(PersistentRedBlackTree &&other) noexcept;
+		PersistentRedBlackTree &operator=(const PersistentRedBlackTree &other);
+		PersistentRedBlackTree &operator=(PersistentRedBlackTree &&other) noexcept;
+
+		PersistentRedBlackTree Snapshot() const { return *this; };
+
+		void Insert(const Key &key, const Value &value = Value());
+		bool TryInsert(const Key &key, const Value &value = Value());
+		bool Remove(const Key &key);
+		void Clear();
+
+		bool Contains(const Key &key) const;
+		const Value *GetValue(const Key &key) const;
+		size_t Size() const { return numItems; };
+		bool Empty() const { return numItems == 0; };
+		const Key &GetMin() const;
+		const Key &GetMax() const;
+
+		template <class Visitor>
+		void ForEach(Visitor visit) const;
+
+	private:
+		using Node = PathCopyNode<Key, Value>;
+		using Writer = PathCopier<Key, Value, Compare>;
+
+		Compare comp;
+		Node *root = nullptr;
+		size_t numItems = 0;
+
+		void Commit(Node *newRoot, const Writer &writer);
+
+		static void Share(Node *n);
+		static void Release(Node *n);
+};
+
+
+#define PATHCOPY_TEMPLATE template <class Key, class Value, class Compare>
+#define PATHCOPY_CLASS PathCopier<Key, Value, Compare>
+
+// Constructor
+// Starts a write with a stamp of its own.
+PATHCOPY_TEMPLATE
+PATHCOPY_CLASS::PathCopier(const Compare &comp, vector<Node *> *replaced)
+    : comp(comp), replaced(replaced), replacedBefore((replaced != nullptr) ? replaced->size() : 0), stamp(NextStamp()) {}
+
+// Destructor
+// Undoes a write that was not kept: its nodes are deleted and the
+// originals it retired stay where they are.
+PATHCOPY_TEMPLATE
+PATHCOPY_CLASS::~PathCopier() {
+    if (kept) return;
+    for (Node *n : created) {
+        delete n;
+    }
+    if (replaced != nullptr) replaced->resize(replacedBefore);
+}
+
+// NextStamp
+// Returns a stamp no write has used before, across all trees.
+PATHCOPY_TEMPLATE
+uint64_t PATHCOPY_CLASS::NextStamp() {
+    static atomic<uint64_t> lastStamp{0};
+    return lastStamp.fetch_add(1, memory_order_relaxed) + 1;
+}
+
+// Insert
+// Returns the root of top with key added, which must not be present.
+PATHCOPY_TEMPLATE
+typename PATHCOPY_CLASS::Node *PATHCOPY_CLASS::Insert(Node *top, const Key &key, const Value &value) {
+    return Blacken(InsertBelow(top, key, value));
+}
+
+// Remove
+// Returns the root of top without key, which must be present.
+PATHCOPY_TEMPLATE
+typename PATHCOPY_CLASS::Node *PATHCOPY_CLASS::Remove(Node *top, const Key &key) {
+    return Blacken(RemoveBelow(top, key));
+}
+
+// Get
+// Returns the node holding key below n, or nullptr.
+PATHCOPY_TEMPLATE
+const typename PATHCOPY_CLASS::Node *PATHCOPY_CLASS::Get(const Node *n, const Key &key, const Compare &comp) {
+    while (n != nullptr) {
+        if (comp(key, n->data)) {
+            n = n->left;
+        } else if (comp(n->data, key)) {
+            n = n->right;
+        } else {
+            return n;
+        }
+    }
+    return nullptr;
+}
+
+// Rebuild
+// Returns a node with n's key and value and the given color and children.
+// A node made by this write is changed in place; any other node is copied
+// and the original retired.
+PATHCOPY_TEMPLATE
+typename PATHCOPY_CLASS::Node *PATHCOPY_CLASS::Rebuild(Node *n, unsigned short int color, Node *left, Node *right) {
+    if (n->stamp != stamp) {
+        Node *copy = Create(n->data, n->value, color, left, right);
+        Retire(n);
+        return copy;
+    }
+    n->color = color;
+    n->left = left;
+    n->right = right;
+    return n;
+}
+
+// Create
+// Allocates a node for this write and records it in created. The slot is
+// taken first, so a failed allocation leaves only a null entry behind.
+PATHCOPY_TEMPLATE
+typename PATHCOPY_CLASS::Node *PATHCOPY_CLASS::Create(const Key &key, const Value &value, unsigned short int color,
+        Node *left, Node *right) {
+    created.push_back(nullptr);
+    try {
+        created.back() = new Node(key, value, color, left, right, stamp);
+    } catch (...) {
+        created.pop_back();
+        throw;
+    }
+    return created.back();
+}
+
+// Retire
+// Drops a node from the new version. One made by this write is deleted,
+// since nothing else can see it; older ones belong to their own versions.
+PATHCOPY_TEMPLATE
+void PATHCOPY_CLASS::Retire(Node *n) {
+    if (n->stamp == stamp) {
+        auto it = find(created.begin(), created.end(), n);
+        *it = created.back();
+        created.pop_back();
+        delete n;
+    } else if (replaced != nullptr) {
+        replaced->push_back(n);
+    }
+}
+
+// Blacken
+// Turns a red root black, the one recoloring that keeps every invariant.
+PATHCOPY_TEMPLATE
+typename PATHCOPY_CLASS::Node *PATHCOPY_CLASS::Blacken(Node *n) {
+    if (IsRed(n)) return Rebuild(n, COLOR_BLACK, n->left, n->right);
+    return n;
+}
+
+// Balance
+// Kahrs' balance: rebuilds middle over left and right as a black node,
+// resolving a red child with a red child of its own by making it a red node
+// with two black children.
+PATHCOPY_TEMPLATE
+typename PATHCOPY_CLASS::Node *PATHCOPY_CLASS::Balance(Node *left, Node *middle, Node *right) {
+    if (IsRed(left) && IsRed(right)) {
+        Node *newLeft = Rebuild(left, COLOR_BLACK, left->left, left->right);
+        Node *newRight = Rebuild(right, COLOR_BLACK, right->left, right->right);
+        return Rebuild(middle, COLOR_RED, newLeft, newRight);
+    }
+    if (IsRed(left) && IsRed(left->left)) {
+        Node *a = left->left, *c = left->right;
+        Node *newLeft = Rebuild(a, COLOR_BLACK, a->left, a->right);
+        Node *newRight = Rebuild(middle, COLOR_BLACK, c, right);
+        return Rebuild(left, COLOR_RED, newLeft, newRight);
+    }
+    if (IsRed(left) && IsRed(left->right)) {
+        Node *top = left->right, *b = top->left, *c = top->right;
+        Node *newLeft = Rebuild(left, COLOR_BLACK, left->left, b);
+        Node *newRight = Rebuild(middle, COLOR_BLACK, c, right);
+        return Rebuild(top, COLOR_RED, newLeft, newRight);
+    }
+    if (IsRed(right) && IsRed(right->right)) {
+        Node *b = right->left, *d = right->right;
+        Node *newLeft = Rebuild(middle, COLOR_BLACK, left, b);
+        Node *newRight = Rebuild(d, COLOR_BLACK, d->left, d->right);
+        return Rebuild(right, COLOR_RED, newLeft, newRight);
+    }
+    if (IsRed(right) && IsRed(right->left)) {
+        Node *top = right->left, *b = top->left, *c = top->right;
+        Node *newLeft = Rebuild(middle, COLOR_BLACK, left, b);
+        Node *newRight = Rebuild(right, COLOR_BLACK, c, right->right);
+        return Rebuild(top, COLOR_RED, newLeft, newRight);
+    }
+    return Rebuild(middle, COLOR_BLACK, left, right);
+}
+
+// BalanceLeft
+// Rebuilds middle after its left side lost one black level in a delete.
+PATHCOPY_TEMPLATE
+typename PATHCOPY_CLASS::Node *PATHCOPY_CLASS::BalanceLeft(Node *left, Node *middle, Node *right) {
+    if (IsRed(left)) {
+        Node *newLeft = Rebuild(left, COLOR_BLACK, left->left, left->right);
+        return Rebuild(middle, COLOR_RED, newLeft, right);
+    }
+    if (IsBlackNode(right)) {
+        return Balance(left, middle, Rebuild(right, COLOR_RED, right->left, right->right));
+    }
+    if (IsRed(right) && IsBlackNode(right->left)) {
+        Node *top = right->left, *a = top->left, *b = top->right, *c = right->right;
+        Node *newLeft = Rebuild(middle, COLOR_BLACK, left, a);
+        Node *newRight = Balance(b, right, Rebuild(c, COLOR_RED, c->left, c->right));
+        return Rebuild(top, COLOR_RED, newLeft, newRight);
+    }
+    throw logic_error("Red-Black invariant broken in BalanceLeft.");
+}
+
+// BalanceRight
+// Rebuilds middle after its right side lost one black level in a delete.
+PATHCOPY_TEMPLATE
+typename PATHCOPY_CLASS::Node *PATHCOPY_CLASS::BalanceRight(Node *left, Node *middle, Node *right) {
+    if (IsRed(right)) {
+        Node *newRight = Rebuild(right, COLOR_BLACK, right->left, right->right);
+        return Rebuild(middle, COLOR_RED, left, newRight);
+    }
+    if (IsBlackNode(left)) {
+        return Balance(Rebuild(left, COLOR_RED, left->left, left->right), middle, right);
+    }
+    if (IsRed(left) && IsBlackNode(left->right)) {
+        Node *top = left->right, *a = left->left, *b = top->left, *c = top->right;
+        Node *newLeft = Balance(Rebuild(a, COLOR_RED, a->left, a->right), left, b);
+        Node *newRight = Rebuild(middle, COLOR_BLACK, c, right);
+        return Rebuild(top, COLOR_RED, newLeft, newRight);
+    }
+    throw logic_error("Red-Black invariant broken in BalanceRight.");
+}
+
+// Combine
+// Merges the two subtrees of a deleted node, all of left's keys being
+// smaller than right's.
+PATHCOPY_TEMPLATE
+typename PATHCOPY_CLASS::Node *PATHCOPY_CLASS::Combine(Node *left, Node *right) {
+    if (left == nullptr) return right;
+    if (right == nullptr) return left;
+
+    if (IsRed(left) && IsRed(right)) {
+        Node *inner = Combine(left->right, right->left);
+        if (IsRed(inner)) {
+            Node *b = inner->left, *c = inner->right;
+            Node *newLeft = Rebuild(left, COLOR_RED, left->left, b);
+            Node *newRight = Rebuild(right, COLOR_RED, c, right->right);
+            return Rebuild(inner, COLOR_RED, newLeft, newRight);
+        }
+        Node *newRight = Rebuild(right, COLOR_RED, inner, right->right);
+        return Rebuild(left, COLOR_RED, left->left, newRight);
+    }
+    if (!IsRed(left) && !IsRed(right)) {
+        Node *inner = Combine(left->right, right->left);
+        if (IsRed(inner)) {
+            Node *b = inner->left, *c = inner->right;
+            Node *newLeft = Rebuild(left, COLOR_BLACK, left->left, b);
+            Node *newRight = Rebuild(right, COLOR_BLACK, c, right->right);
+            return Rebuild(inner, COLOR_RED, newLeft, newRight);
+        }
+        Node *newRight = Rebuild(right, COLOR_BLACK, inner, right->right);
+        return BalanceLeft(left->left, left, newRight);
+    }
+    if (IsRed(right)) {
+        Node *inner = Combine(left, right->left);
+        return Rebuild(right, COLOR_RED, inner, right->right);
+    }
+    Node *inner = Combine(left->right, right);
+    return Rebuild(left, COLOR_RED, left->left, inner);
+}
+
+// InsertBelow
+// Returns the subtree n with key added. The result may have a red root.
+PATHCOPY_TEMPLATE
+typename PATHCOPY_CLASS::Node *PATHCOPY_CLASS::InsertBelow(Node *n, const Key &key, const Value &value) {
+    if (n == nullptr) return Create(key, value, COLOR_RED, nullptr, nullptr);
+    if (comp(key, n->data)) {
+        Node *left = InsertBelow(n->left, key, value);
+        return (n->color == COLOR_RED) ? Rebuild(n, COLOR_RED, left, n->right) : Balance(left, n, n->right);
+    }
+    Node *right = InsertBelow(n->right, key, value);
+    return (n->color == COLOR_RED) ? Rebuild(n, COLOR_RED, n->left, right) : Balance(n->left, n, right);
+}
+
+// RemoveBelow
+// Returns the subtree n without key, which must be present. A black
+// subtree comes back one black level shorter, with BalanceLeft and
+// BalanceRight restoring the height on the way up.
+PATHCOPY_TEMPLATE
+typename PATHCOPY_CLASS::Node *PATHCOPY_CLASS::RemoveBelow(Node *n, const Key &key) {
+    if (comp(key, n->data)) {
+        bool shrinks = IsBlackNode(n->left);
+        Node *left = RemoveBelow(n->left, key);
+        return shrinks ? BalanceLeft(left, n, n->right) : Rebuild(n, COLOR_RED, left, n->right);
+    }
+    if (comp(n->data, key)) {
+        bool shrinks = IsBlackNode(n->right);
+        Node *right = RemoveBelow(n->right, key);
+        return shrinks ? BalanceRight(n->left, n, right) : Rebuild(n, COLOR_RED, n->left, right);
+    }
+    Node *merged = Combine(n->left, n->right);
+    Retire(n);
+    return merged;
+}
+
+#undef PATHCOPY_CLASS
+#undef PATHCOPY_TEMPLATE
+
+
+#define PRBT_TEMPLATE template <class Key, class Value, class Compare>
+#define PRBT_CLASS PersistentRedBlackTree<Key, Value, Compare>
+
+// Copy Constructor
+// Shares other's nodes; nothing is copied until one of the two is written.
+PRBT_TEMPLATE
+PRBT_CLASS::PersistentRedBlackTree(const PersistentRedBlackTree &other)
+    : comp(other.comp), root(other.root), numItems(other.numItems) {
+    Share(root);
+}
+
+// Move Constructor
+// Takes over other's version, leaving it empty.
+PRBT_TEMPLATE
+PRBT_CLASS::PersistentRedBlackTree(PersistentRedBlackTree &&other) noexcept
+    : comp(other.comp), root(other.root), numItems(other.numItems) {
+    other.root = nullptr;
+    other.numItems = 0;
+}
+
+// Copy Assignment
+// Drops this tree's version and shares other's.
+PRBT_TEMPLATE
+PRBT_CLASS &PRBT_CLASS::operator=(const PersistentRedBlackTree &other) {
+    Share(other.root);
+    Release(root);
+    comp = other.comp;
+    root = other.root;
+    numItems = other.numItems;
+    return *this;
+}
+
+// Move Assignment
+// Drops this tree's version and takes over other's, leaving it empty.
+PRBT_TEMPLATE
+PRBT_CLASS &PRBT_CLASS::operator=(PersistentRedBlackTree &&other) noexcept {
+    if (this != &other) {
+        Release(root);
+        comp = other.comp;
+        root = other.root;
+        numItems = other.numItems;
+        other.root = nullptr;
+        other.numItems = 0;
+    }
+    return *this;
+}
+
+// Insert
+// Adds a key, throwing invalid_argument if it is already present.
+PRBT_TEMPLATE
+void PRBT_CLASS::Insert(const Key &key, const Value &value) {
+    if (!TryInsert(key, value)) {
+        throw invalid_argument("Duplicate entry not allowed.");
+    }
+}
+
+// TryInsert
+// Adds a key with a value. Returns false and changes nothing if the key is
+// already present. Other versions sharing nodes with this one are not
+// affected.
+PRBT_TEMPLATE
+bool PRBT_CLASS::TryInsert(const Key &key, const Value &value) {
+    if (Writer::Get(root, key, comp) != nullptr) return false;
+    Writer writer(comp, nullptr);
+    Node *newRoot = writer.Insert(root, key, value);
+    writer.Keep();
+    Commit(newRoot, writer);
+    numItems++;
+    return true;
+}
+
+// Remove
+// Deletes a key. Returns false if it was not present.
+PRBT_TEMPLATE
+bool PRBT_CLASS::Remove(const Key &key) {
+    if (Writer::Get(root, key, comp) == nullptr) return false;
+    Writer writer(comp, nullptr);
+    Node *newRoot = writer.Remove(root, key);
+    writer.Keep();
+    Commit(newRoot, writer);
+    numItems--;
+    return true;
+}
+
+// Clear
+// Drops this tree's version. Nodes other versions still use are kept.
+PRBT_TEMPLATE
+void PRBT_CLASS::Clear() {
+    Release(root);
+    root = nullptr;
+    numItems = 0;
+}
+
+// Contains
+// Returns true if the tree contains the key.
+PRBT_TEMPLATE
+bool PRBT_CLASS::Contains(const Key &key) const {
+    return Writer::Get(root, key, comp) != nullptr;
+}
+
+// GetValue
+// Returns the value stored under key, or nullptr if the key is not present.
+// The pointer stays valid until this tree is next written or destroyed.
+PRBT_TEMPLATE
+const Value *PRBT_CLASS::GetValue(const Key &key) const {
+    const Node *n = Writer::Get(root, key, comp);
+    return (n != nullptr) ? &n->value : nullptr;
+}
+
+// GetMin
+// Returns the smallest key. Throws underflow_error if the tree is empty.
+PRBT_TEMPLATE
+const Key &PRBT_CLASS::GetMin() const {
+    const Node *n = root;
+    if (n == nullptr) throw underflow_error("Tree is empty.");
+    while (n->left != nullptr) n = n->left;
+    return n->data;
+}
+
+// GetMax
+// Returns the largest key. Throws underflow_error if the tree is empty.
+PRBT_TEMPLATE
+const Key &PRBT_CLASS::GetMax() const {
+    const Node *n = root;
+    if (n == nullptr) throw underflow_error("Tree is empty.");
+    while (n->right != nullptr) n = n->right;
+    return n->data;
+}
+
+// ForEach
+// Calls visit(key) in key order.
+PRBT_TEMPLATE
+template <class Visitor>
+void PRBT_CLASS::ForEach(Visitor visit) const {
+    vector<const Node *> path;
+    const Node *n = root;
+    while (n != nullptr || !path.empty()) {
+        while (n != nullptr) {
+            path.push_back(n);
+            n = n->left;
+        }
+        n = path.back();
+        path.pop_back();
+        visit(n->data);
+        n = n->right;
+    }
+}
+
+// Commit
+// Makes newRoot this tree's version. The nodes the write created hang off
+// the root as one connected top part, since older nodes never change; each
+// takes one reference, from its parent or from the tree, and each older
+// node they point at gains one. Only then is the old version released,
+// freeing the nodes no version uses anymore. Nothing here allocates, so a
+// kept write always commits.
+PRBT_TEMPLATE
+void PRBT_CLASS::Commit(Node *newRoot, const Writer &writer) {
+    if (newRoot != nullptr && !writer.IsFresh(newRoot)) Share(newRoot);
+    for (Node *n : writer.Created()) {
+        n->refs.store(1, memory_order_relaxed);
+        for (Node *child : {n->left, n->right}) {
+            if (child != nullptr && !writer.IsFresh(child)) Share(child);
+        }
+    }
+    Release(root);
+    root = newRoot;
+}
+
+// Share
+// Adds a reference to n.
+PRBT_TEMPLATE
+void PRBT_CLASS::Share(Node *n) {
+    if (n != nullptr) n->refs.fetch_add(1, memory_order_relaxed);
+}
+
+// Release
+// Drops a reference to n, freeing it and releasing its children when it was
+// the last one.
+PRBT_TEMPLATE
+void PRBT_CLASS::Release(Node *n) {
+    if (n == nullptr || n->refs.fetch_sub(1, memory_order_acq_rel) != 1) return;
+    vector<Node *> pending{n};
+    while (!pending.empty()) {
+        Node *next = pending.back();
+        pending.pop_back();
+        for (Node *child : {next->left, next->right}) {
+            if (child != nullptr && child->refs.fetch_sub(1, memory_order_acq_rel) == 1) {
+                pending.push_back(child);
+            }
+        }
+        delete next;
+    }
+}
+
+#undef PRBT_CLASS
+#undef PRBT_TEMPLATE
+
+#endif
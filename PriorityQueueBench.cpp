@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <random>
+#include <set>
+#include <vector>
+#include "RedBlackTree.h"
+
+/**
+ *
+ * RedBlackTree as a min priority queue against std::priority_queue and
+ * std::set. Each queue is filled with random keys, then runs the hold
+ * pattern of an event queue (pop the smallest key, push it back further
+ * ahead) and is finally drained with one pop per key.
+ *
+ * Usage: ./pq-bench [keys] [hold operations]
+ *
+**/
+
+using namespace std;
+
+// Runs work once and returns the operations per second in millions.
+template <class Work>
+static double Rate(size_t operations, Work work) {
+    auto start = chrono::steady_clock::now();
+    work();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return operations / seconds / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+    size_t keyCount = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 1000000;
+    size_t holdCount = (argc > 2) ? strtoull(argv[2], nullptr, 10) : 2000000;
+
+    mt19937 gen(1);
+    uniform_int_distribution<int> dist(0, 1 << 30);
+    vector<int> keys(keyCount), steps(holdCount);
+    for (int &key : keys) {
+        key = dist(gen);
+    }
+    uniform_int_distribution<int> step(1, 1 << 20);
+    for (int &s : steps) {
+        s = step(gen);
+    }
+
+    // The tree and the set drop duplicate keys, so the hold pattern offsets
+    // a colliding key until it is new and both end up with the same keys.
+    long long checksum[2] = {0, 0};
+    double fill[3], hold[3], drain[3];
+    {
+        RedBlackTree tree;
+        fill[0] = Rate(keyCount, [&]() {
+            for (int key : keys) tree.TryInsert(key);
+        });
+        hold[0] = Rate(holdCount, [&]() {
+            for (int s : steps) {
+                int key = tree.PopMin() + s;
+                while (!tree.TryInsert(key)) key++;
+            }
+        });
+        drain[0] = Rate(tree.Size(), [&]() {
+            while (tree.Size() != 0) checksum[0] += tree.PopMin();
+        });
+    }
+    {
+        set<int> ordered;
+        fill[1] = Rate(keyCount, [&]() {
+            for (int key : keys) ordered.insert(key);
+        });
+        hold[1] = Rate(holdCount, [&]() {
+            for (int s : steps) {
+                int key = *ordered.begin() + s;
+                ordered.erase(ordered.begin());
+                while (!ordered.insert(key).second) key++;
+            }
+        });
+        drain[1] = Rate(ordered.size(), [&]() {
+            while (!ordered.empty()) {
+                checksum[1] += *ordered.begin();
+                ordered.erase(ordered.begin());
+            }
+        });
+    }
+    {
+        // The heap keeps duplicates instead of offsetting them, so it is
+        // checked for popping in order rather than against the checksum.
+        priority_queue<int, vector<int>, greater<int>> heap;
+        vector<int> distinct(keys.begin(), keys.end());
+        sort(distinct.begin(), distinct.end());
+        distinct.erase(unique(distinct.begin(), distinct.end()), distinct.end());
+        shuffle(distinct.begin(), distinct.end(), gen);
+        fill[2] = Rate(distinct.size(), [&]() {
+            for (int key : distinct) heap.push(key);
+        });
+        hold[2] = Rate(holdCount, [&]() {
+            for (int s : steps) {
+                int key = heap.top() + s;
+                heap.pop();
+                heap.push(key);
+            }
+        });
+        bool ordered = true;
+        drain[2] = Rate(heap.size(), [&]() {
+            int last = heap.top();
+            while (!heap.empty()) {
+                ordered &= (heap.top() >= last);
+                last = heap.top();
+                heap.pop();
+            }
+        });
+        if (!ordered) {
+            cerr << "heap out of order" << endl;
+            return 1;
+        }
+    }
+    if (checksum[0] != checksum[1]) {
+        cerr << "checksum mismatch" << endl;
+        return 1;
+    }
+
+    const char *names[3] = {"RedBlackTree       ", "std::set           ", "std::priority_queue"};
+    cout << "keys: " << keyCount << ", hold operations: " << holdCount << endl;
+    cout << "queue               | fill Mops/s | hold Mops/s | drain Mops/s" << endl;
+    for (int i = 0; i < 3; i++) {
+        cout << names[i] << " | " << fill[i] << " | " << hold[i] << " | " << drain[i] << endl;
+    }
+    return 0;
+}
@@ -6,72 +6,439 @@
 #define COLOR_BLACK 1
 #define COLOR_DOUBLE_BLACK 2
 
+// Hint the CPU to start loading a node before it is needed.
+#if defined(__GNUC__) || defined(__clang__)
+#define RBT_PREFETCH(address) __builtin_prefetch(address)
+#else
+#define RBT_PREFETCH(address) ((void)0)
+#endif
+
+// Building every translation unit with RBT_ENABLE_STATS defined makes each
+// tree count its rotations, recolors and descents for GetStats. Without it
+// the counters do not exist and RBT_COUNT compiles to nothing. The setting
+// changes the tree's layout, so it must be the same for the whole program,
+// RedBlackTree.cpp included.
+#ifdef RBT_ENABLE_STATS
+#define RBT_COUNT(counter, amount) (stats.counter.fetch_add((amount), memory_order_relaxed))
+#else
+#define RBT_COUNT(counter, amount) ((void)0)
+#endif
+
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "NodePool.h"
+#include "TaskPool.h"
+#include "TreeFile.h"
 
 using namespace std;
 
 
-struct RBTNode {
-	int data;
-	unsigned short int color;
-	RBTNode *left = nullptr;
-	RBTNode *right = nullptr;
-	RBTNode *parent = nullptr;
+// Visiting order for ForEach and the string/stream writers.
+enum class Traversal { Infix, Prefix, Postfix };
+
+
+// Mapped type for set-style trees that store keys only.
+struct NoValue {};
+
+
+// Snapshot returned by GetStats. The counters only move when the program is
+// built with RBT_ENABLE_STATS and run from the tree's creation or the last
+// ResetStats; the shape fields are measured by GetStats itself every time.
+struct RBTStats {
+	bool countersEnabled = false;
+
+	unsigned long long searches = 0;            // lookup descents: Contains, Find, GetValue, Remove...
+	unsigned long long searchComparisons = 0;   // nodes compared against during those descents
+	unsigned long long insertDescents = 0;
+	unsigned long long insertComparisons = 0;
+	unsigned long long insertRecolorCases = 0;  // red uncle: recolor and move up
+	unsigned long long insertOuterRotations = 0;  // node and parent on the same side: one rotation
+	unsigned long long insertInnerRotations = 0;  // zig-zag, rotated into the outer case
+	unsigned long long removeCases[4] = {};     // RemoveFixUp cases 1 to 4
+	unsigned long long leftRotations = 0;       // every rotation, joins and splits included
+	unsigned long long rightRotations = 0;
+	unsigned long long recolors = 0;            // node colors written by the fix ups
+
+	size_t maxDepth = 0;        // nodes on the longest root-to-leaf path
+	double averageDepth = 0;    // mean number of nodes from the root to a key, itself included
+	int blackHeight = 0;        // black nodes on every root-to-leaf path, or -1 if they differ
+	bool balanced = true;       // black root, no red node with a red child and one black height
+
+	double ComparisonsPerSearch() const { return searches ? double(searchComparisons) / searches : 0; };
+	double ComparisonsPerInsert() const { return insertDescents ? double(insertComparisons) / insertDescents : 0; };
+};
+
+
+// Subtree size kept in each node when order statistics are enabled.
+// The disabled version is empty and costs nothing thanks to the empty base optimization.
+template <bool OrderStatistics>
+struct RBTNodeSize {};
+
+template <>
+struct RBTNodeSize<true> {
+	size_t subtreeSize = 1;
+};
+
+
+template <class Key, class Value = NoValue, bool OrderStatistics = false>
+struct BasicRBTNode : RBTNodeSize<OrderStatistics> {
+	Key data;
+	unsigned short int color = COLOR_RED;
+	BasicRBTNode *left = nullptr;
+	BasicRBTNode *right = nullptr;
+	BasicRBTNode *parent = nullptr;
 	bool IsNullNode = false;
+	Value value;   // last, so a descent only touches the key and the links
+
+	template <class K, class... Args>
+	explicit BasicRBTNode(K &&key, Args &&... args) : data(forward<K>(key)), value(forward<Args>(args)...) {};
 };
 
+using RBTNode = BasicRBTNode<int>;
+
+
+// Pointer-free read-only copy made by Freeze(), defined in FrozenRedBlackTree.h.
+template <class Key, class Value = NoValue, class Compare = less<Key>>
+class FrozenRedBlackTree;
+
+// Copy made a bounded number of nodes at a time, defined in IncrementalRebuild.h.
+template <class Tree>
+class IncrementalCopy;
+
+
+// BasicRedBlackTree
+// Ordered set or map of unique keys. Key and Value are stored inline in the
+// node, Compare orders the keys and Alloc supplies the pool's node blocks.
+// OrderStatistics adds a subtree size to every node so Rank, Select and
+// CountInRange run in O(log n).
+// RedBlackTree is the plain int set, RankedRedBlackTree the int set with
+// order statistics, and RedBlackTreeMap<Key, Value> the map form.
+template <class Key, class Value = NoValue, class Compare = less<Key>, class Alloc = allocator<Key>, bool OrderStatistics = false>
+class BasicRedBlackTree {
 
-class RedBlackTree {
-	
 	public:
-		RedBlackTree();
-		RedBlackTree(int newData);
-		RedBlackTree(const RedBlackTree &rbt);
-		~RedBlackTree(); //added this for my destructor 
-		
+		using Node = BasicRBTNode<Key, Value, OrderStatistics>;
+		using allocator_type = typename NodePool<Node, Alloc>::allocator_type;
+
+		// Subproblems smaller than this many keys are not forked by the TaskPool overloads.
+		static constexpr size_t PARALLEL_GRAIN = 16384;
+
+		// Move assignment can only fail when the nodes have to be moved one by one.
+		static constexpr bool MOVE_ASSIGN_NOEXCEPT =
+			allocator_traits<allocator_type>::propagate_on_container_move_assignment::value ||
+			allocator_traits<allocator_type>::is_always_equal::value;
+
+		// Bidirectional in-order iterator over the keys. Stepping uses the
+		// parent pointers, so a full scan allocates nothing. Inserting into the
+		// tree does not invalidate iterators; removing a key only invalidates
+		// iterators to that key.
+		class const_iterator {
+			public:
+				using iterator_category = bidirectional_iterator_tag;
+				using value_type = Key;
+				using difference_type = ptrdiff_t;
+				using pointer = const Key *;
+				using reference = const Key &;
+
+				const_iterator() = default;
+
+				reference operator*() const { return node->data; };
+				pointer operator->() const { return &node->data; };
+				const Key &key() const { return node->data; };
+				const Value &value() const { return node->value; };
+
+				const_iterator &operator++() { node = InfixNext(node); return *this; };
+				const_iterator operator++(int) { const_iterator old = *this; ++*this; return old; };
+				const_iterator &operator--() { node = (node == nullptr) ? InfixLast(tree->root) : InfixPrev(node); return *this; };
+				const_iterator operator--(int) { const_iterator old = *this; --*this; return old; };
+
+				bool operator==(const const_iterator &other) const { return node == other.node; };
+				bool operator!=(const const_iterator &other) const { return node != other.node; };
+
+			private:
+				friend class BasicRedBlackTree;
+				const_iterator(const Node *n, const BasicRedBlackTree *t) : node(n), tree(t) {};
+
+				const Node *node = nullptr;
+				const BasicRedBlackTree *tree = nullptr;
+		};
+		using iterator = const_iterator;
+
+		BasicRedBlackTree();
+		explicit BasicRedBlackTree(const Compare &comp, const allocator_type &alloc = allocator_type());
+		explicit BasicRedBlackTree(const allocator_type &alloc);
+		BasicRedBlackTree(const Key &newData);
+		BasicRedBlackTree(const BasicRedBlackTree &rbt);
+		BasicRedBlackTree(const BasicRedBlackTree &rbt, const allocator_type &alloc);
+		BasicRedBlackTree(BasicRedBlackTree &&rbt) noexcept;
+		template <class InputIt, class = typename iterator_traits<InputIt>::iterator_category>
+		BasicRedBlackTree(InputIt first, InputIt last);
+		template <class InputIt, class = typename iterator_traits<InputIt>::iterator_category>
+		BasicRedBlackTree(InputIt first, InputIt last, TaskPool &tasks, size_t grain = PARALLEL_GRAIN);
+		~BasicRedBlackTree(); //added this for my destructor
+
+		BasicRedBlackTree &operator=(const BasicRedBlackTree &rbt);
+		BasicRedBlackTree &operator=(BasicRedBlackTree &&rbt) noexcept(MOVE_ASSIGN_NOEXCEPT);
+		void Swap(BasicRedBlackTree &rbt) noexcept;
+		void Clear();
+
+
+
+		string ToInfixString() const { return ToString(Traversal::Infix);};
+		string ToPrefixString() const { return ToString(Traversal::Prefix);};
+		string ToPostfixString() const { return ToString(Traversal::Postfix);};
+
+		string ToString(Traversal order) const;
+		void AppendString(string &out, Traversal order) const;
+		void WriteString(ostream &os, Traversal order) const;
+
+		template <class Visitor>
+		void ForEach(Visitor visit, Traversal order = Traversal::Infix) const;
+		template <class OutputIt>
+		OutputIt CopyKeys(OutputIt out, Traversal order = Traversal::Infix) const;
+
+		void Insert(const Key &newData);
+		bool TryInsert(const Key &newData);
+		const_iterator Insert(const_iterator hint, const Key &newData);
+		pair<const_iterator, bool> TryInsert(const_iterator hint, const Key &newData);
+		template <class... Args>
+		pair<const_iterator, bool> Emplace(Key key, Args &&... args);
+		template <class InputIt>
+		size_t InsertMany(InputIt first, InputIt last, vector<Key> *duplicates = nullptr);
+
+		bool Remove(const Key &data);
+		const_iterator Erase(const_iterator pos);
+		Key PopMin();
+		Key PopMax();
 
+		template <class InputIt>
+		void BuildFromSorted(InputIt first, InputIt last);
 
-		string ToInfixString() const {return ToInfixString(root);};
-		string ToPrefixString() const { return ToPrefixString(root);};
-		string ToPostfixString() const { return ToPostfixString(root);};
+		void Save(const string &path) const;
+		void Load(const string &path);
 
-		void Insert(int newData);
+		FrozenRedBlackTree<Key, Value, Compare> Freeze() const;
 
-		bool Contains(int data) const ;
+		void Join(BasicRedBlackTree &&greater);
+		BasicRedBlackTree Split(const Key &key);
+		void Union(BasicRedBlackTree &&other);
+		void Intersection(BasicRedBlackTree &&other);
+		void Difference(BasicRedBlackTree &&other);
+		void Union(BasicRedBlackTree &&other, TaskPool &tasks, size_t grain = PARALLEL_GRAIN);
+		void Intersection(BasicRedBlackTree &&other, TaskPool &tasks, size_t grain = PARALLEL_GRAIN);
+		void Difference(BasicRedBlackTree &&other, TaskPool &tasks, size_t grain = PARALLEL_GRAIN);
+
+		bool Contains(const Key &data) const ;
+		void ContainsMany(const Key *keys, size_t count, bool *found) const;
+		void ContainsMany(const vector<Key> &keys, vector<bool> &found) const;
+		void FindMany(const Key *keys, size_t count, const_iterator *found) const;
+		const_iterator Find(const Key &data) const { return const_iterator(Get(data), this);};
 		size_t Size() const {return numItems;};
-		int GetMin() const;
-		int GetMax() const;
-	
+		size_t Capacity() const {return pool.Capacity();};
+		const Key &GetMin() const;
+		const Key &GetMax() const;
+
+		Value *GetValue(const Key &data);
+		const Value *GetValue(const Key &data) const;
+		Value &At(const Key &data);
+		const Value &At(const Key &data) const;
+		// Value an iterator points to, for changing it in place with no second lookup.
+		Value &ValueOf(const_iterator pos) { return const_cast<Node *>(pos.node)->value;};
+
+		const_iterator begin() const { return const_iterator(leftmost, this);};
+		const_iterator end() const { return const_iterator(nullptr, this);};
+
+		const_iterator LowerBound(const Key &data) const;
+		const_iterator UpperBound(const Key &data) const;
+		pair<const_iterator, const_iterator> Range(const Key &low, const Key &high) const;
+
+		// Order statistics, only available when OrderStatistics is true.
+		template <bool Enabled = OrderStatistics, class = enable_if_t<Enabled>>
+		size_t Rank(const Key &data) const;
+		template <bool Enabled = OrderStatistics, class = enable_if_t<Enabled>>
+		const Key &Select(size_t k) const;
+		template <bool Enabled = OrderStatistics, class = enable_if_t<Enabled>>
+		size_t CountInRange(const Key &low, const Key &high) const;
+
+		RBTStats GetStats() const;
+		void ResetStats();
+		bool Validate(string *problem = nullptr) const;
+
+		Compare GetComparator() const { return comp;};
+		allocator_type GetAllocator() const { return pool.GetAllocator();};
+
+
+
+
+	private:
+		template <class>
+		friend class IncrementalCopy;
+
+		// Built-in keys under the default ordering take a single compare per level
+		// that the compiler can turn into a conditional move.
+		static constexpr bool FAST_COMPARE = is_arithmetic<Key>::value &&
+			(is_same<Compare, less<Key>>::value || is_same<Compare, less<>>::value);
 
-		
-	
-	private: 
 		unsigned long long int numItems  = 0;
-		RBTNode *root = nullptr;
-		
-		static string ToInfixString(const RBTNode *n);
-		static string ToPrefixString(const RBTNode *n);
-		static string ToPostfixString(const RBTNode *n);
-		
-		static string GetColorString(const RBTNode *n);
-		static string GetNodeString(const RBTNode *n);
-		
-		void BasicInsert(RBTNode *node);
-		void InsertFixUp(RBTNode *node);
-		
-		RBTNode *GetUncle(RBTNode *node) const;
-		
-		bool IsLeftChild(RBTNode *node) const;
-		bool IsRightChild(RBTNode *node) const;
-		
-		void LeftRotate(RBTNode *node);
-		void RightRotate(RBTNode *node);
-		
-		RBTNode *CopyOf(const RBTNode *node);
-
-
-		RBTNode *Get(int data) const;
+		Node *root = nullptr;
+		// The first and last nodes in key order, nullptr when empty. Kept up by
+		// BasicInsert and RemoveNode, and reset whenever root is replaced.
+		Node *leftmost = nullptr;
+		Node *rightmost = nullptr;
+		Compare comp;
+		NodePool<Node, Alloc> pool;
+
+#ifdef RBT_ENABLE_STATS
+		// Live counters behind RBTStats. Relaxed atomics, so readers on
+		// several threads can count their searches at once.
+		struct Counters {
+			atomic<unsigned long long> searches{0}, searchComparisons{0};
+			atomic<unsigned long long> insertDescents{0}, insertComparisons{0};
+			atomic<unsigned long long> insertRecolorCases{0}, insertOuterRotations{0}, insertInnerRotations{0};
+			atomic<unsigned long long> removeCase1{0}, removeCase2{0}, removeCase3{0}, removeCase4{0};
+			atomic<unsigned long long> leftRotations{0}, rightRotations{0}, recolors{0};
+		};
+		mutable Counters stats;
+#endif
+
+		bool Equivalent(const Key &a, const Key &b) const { return !comp(a, b) && !comp(b, a);};
+
+		template <class NodeVisitor>
+		void ForEachNode(NodeVisitor visit, Traversal order) const;
+
+		static const Node *InfixFirst(const Node *n);
+		static const Node *InfixNext(const Node *n);
+		static const Node *InfixLast(const Node *n);
+		static const Node *InfixPrev(const Node *n);
+		static const Node *PrefixNext(const Node *n);
+		static const Node *PostfixFirst(const Node *n);
+		static const Node *PostfixNext(const Node *n);
+
+		static void AppendNodeString(const Node *n, string &out);
+
+		static size_t SubtreeSize(const Node *n);
+		static void UpdateSubtreeSize(Node *n);
+
+		template <class... Args>
+		pair<Node *, bool> BasicInsert(Node *start, Key &&newData, Args &&... args);
+		Node *FingerStart(Node *finger, const Key &data) const;
+		Node *HintStart(const Node *hint, const Key &data) const;
+		bool InsertFixUp(Node *node, Node *&top);
+
+		void RemoveNode(Node *node);
+		void RemoveFixUp(Node *node, Node *parent);
+		void Transplant(Node *node, Node *replacement);
+		void ResetEnds();
+		static bool IsBlack(const Node *node) { return node == nullptr || node->color == COLOR_BLACK;};
+		// a if pick is set, else b. Masks instead of a ?: the compiler would
+		// turn into a branch, which the bound searches mispredict on about
+		// every other level.
+		static const Node *SelectNode(bool pick, const Node *a, const Node *b) {
+			uintptr_t keepA = -static_cast<uintptr_t>(pick);
+			return reinterpret_cast<const Node *>((reinterpret_cast<uintptr_t>(a) & keepA) | (reinterpret_cast<uintptr_t>(b) & ~keepA));
+		};
+
+		// A detached subtree and its black height, the unit the join based
+		// set operations work on. None of the Subtree helpers touch root,
+		// numItems or the pool, so disjoint subtrees can be worked on in parallel.
+		struct Subtree {
+			Node *root;
+			int blackHeight;
+		};
+		static int BlackHeight(const Node *node);
+		static void Unlink(Node *node, int blackHeight, Subtree &left, Subtree &right);
+		Subtree JoinSubtrees(Subtree left, Node *middle, Subtree right);
+		Subtree JoinSubtrees(Subtree left, Subtree right);
+		Node *SplitSubtree(Subtree tree, const Key &key, Subtree &less, Subtree &greater);
+		Node *SplitLast(Subtree tree, Subtree &rest);
+		enum class SetOperation { Union, Intersection, Difference };
+		void CombineWith(SetOperation operation, BasicRedBlackTree &other, TaskPool *tasks, size_t grain);
+		Subtree CombineSubtrees(SetOperation operation, Subtree a, Subtree b, vector<Node *> &dropped,
+				TaskPool *tasks, int forkHeight);
+		static int ForkHeight(size_t grain);
+		Subtree AdoptNodes(BasicRedBlackTree &other);
+		void SetRoot(Subtree tree);
+		void Discard(Node *node);
+		void DiscardSubtree(Node *node);
+
+		Node *GetUncle(Node *node) const;
+
+		bool IsLeftChild(Node *node) const;
+		bool IsRightChild(Node *node) const;
+
+		void LeftRotate(Node *node, Node *&top);
+		void RightRotate(Node *node, Node *&top);
+
+		template <bool MoveKeys>
+		Node *CopyOf(conditional_t<MoveKeys, Node, const Node> *node);
+		template <bool MoveKeys>
+		Node *CloneNode(conditional_t<MoveKeys, Node, const Node> *from, Node *parent);
+		template <bool MoveKeys>
+		bool CopySteps(conditional_t<MoveKeys, Node, const Node> *top,
+				conditional_t<MoveKeys, Node, const Node> *&from, Node *&to, size_t budget);
+		void DestroyAll();
+		void DestroyNodes(Node *node);
+
+		void SortUnique(vector<Key> &keys, TaskPool *tasks, size_t grain);
+		void SortKeys(Key *keys, size_t count, TaskPool *tasks, size_t grain);
+		void BuildSorted(const Key *keys, size_t count, TaskPool *tasks = nullptr, size_t grain = PARALLEL_GRAIN);
+		Node *BuildSortedRange(const Key *keys, size_t count, int depth, int redDepth, Node *parent);
+		Node *BuildSortedSlots(const Key *keys, Node *slots, size_t count, int depth, int redDepth, Node *parent,
+				TaskPool *tasks, size_t grain);
+
+
+		Node *Get(const Key &data) const;
+
+		static constexpr size_t LOOKUP_LANES = 16;
+		template <class Emit>
+		void GetMany(const Key *keys, size_t count, Emit emit) const;
 
 };
 
-#endif
\ No newline at end of file
+
+template <class Key, class Value, class Compare = less<Key>, class Alloc = allocator<Key>>
+using RedBlackTreeMap = BasicRedBlackTree<Key, Value, Compare, Alloc>;
+
+// swap
+// Lets std::swap and ADL find the O(1) member Swap.
+template <class Key, class Value, class Compare, class Alloc, bool OrderStatistics>
+void swap(BasicRedBlackTree<Key, Value, Compare, Alloc, OrderStatistics> &a,
+		BasicRedBlackTree<Key, Value, Compare, Alloc, OrderStatistics> &b) noexcept {
+	a.Swap(b);
+}
+
+using RedBlackTree = BasicRedBlackTree<int>;
+using RankedRedBlackTree = BasicRedBlackTree<int, NoValue, less<int>, allocator<int>, true>;
+
+// Trees whose pool takes its node blocks from the memory_resource passed to
+// the constructor, e.g. a PageArenaResource for huge pages or NUMA placement.
+using PmrRedBlackTree = BasicRedBlackTree<int, NoValue, less<int>, pmr::polymorphic_allocator<int>>;
+template <class Key, class Value, class Compare = less<Key>>
+using PmrRedBlackTreeMap = RedBlackTreeMap<Key, Value, Compare, pmr::polymorphic_allocator<Key>>;
+
+
+#define RBT_TEMPLATE template <class Key, class Value, class Compare, class Alloc, bool OrderStatistics>
+#define RBT_CLASS BasicRedBlackTree<Key, Value, Compare, Alloc, OrderStatistics>
+
+#include "RedBlackTree.tpp"
+
+#undef RBT_CLASS
+#undef RBT_TEMPLATE
+
+// The int trees are compiled once in RedBlackTree.cpp.
+extern template class BasicRedBlackTree<int>;
+extern template class BasicRedBlackTree<int, NoValue, less<int>, allocator<int>, true>;
+extern template class BasicRedBlackTree<int, NoValue, less<int>, pmr::polymorphic_allocator<int>>;
+
+#endif
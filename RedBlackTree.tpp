@@ -0,0 +1,1973 @@
+// Author: Wesley Ihezuo
+// Date: 04/24/2025
+
+// Member definitions for BasicRedBlackTree. Included at the bottom of
+// RedBlackTree.h; do not include this file directly.
+
+#include <charconv>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <stdexcept>
+
+using namespace std;
+
+// Default Constructor
+// Initializes an empty tree (no nodes yet).
+RBT_TEMPLATE
+RBT_CLASS::BasicRedBlackTree() {
+    root = nullptr;
+    numItems = 0;
+}
+
+// Constructor with a custom comparator and allocator.
+RBT_TEMPLATE
+RBT_CLASS::BasicRedBlackTree(const Compare &comp, const allocator_type &alloc) : comp(comp), pool(alloc) {
+    root = nullptr;
+    numItems = 0;
+}
+
+// Constructor with a custom allocator and the default comparator.
+RBT_TEMPLATE
+RBT_CLASS::BasicRedBlackTree(const allocator_type &alloc) : pool(alloc) {
+    root = nullptr;
+    numItems = 0;
+}
+
+// Constructor that creates a tree with a single black root node.
+RBT_TEMPLATE
+RBT_CLASS::BasicRedBlackTree(const Key &newData) {
+    root = pool.Create(newData);
+    root->color = COLOR_BLACK;  // Root is always black by property of Red-Black Trees
+    leftmost = rightmost = root;
+    numItems = 1;
+}
+
+// Copy Constructor
+// Creates a deep copy of another RedBlackTree (new memory, same structure and values).
+// The pool is sized up front so the copy lands in a single block.
+RBT_TEMPLATE
+RBT_CLASS::BasicRedBlackTree(const BasicRedBlackTree &rbt)
+    : comp(rbt.comp), pool(allocator_traits<allocator_type>::select_on_container_copy_construction(rbt.pool.GetAllocator())) {
+    pool.Reserve(rbt.Size());
+    root = CopyOf<false>(rbt.root);
+    ResetEnds();
+    numItems = rbt.numItems;
+}
+
+// Copy Constructor with an explicit allocator for the new tree's nodes.
+RBT_TEMPLATE
+RBT_CLASS::BasicRedBlackTree(const BasicRedBlackTree &rbt, const allocator_type &alloc) : comp(rbt.comp), pool(alloc) {
+    pool.Reserve(rbt.Size());
+    root = CopyOf<false>(rbt.root);
+    ResetEnds();
+    numItems = rbt.numItems;
+}
+
+// Move Constructor
+// Takes over the other tree's pool and root in O(1), leaving it empty.
+RBT_TEMPLATE
+RBT_CLASS::BasicRedBlackTree(BasicRedBlackTree &&rbt) noexcept : comp(rbt.comp), pool(move(rbt.pool)) {
+    root = rbt.root;
+    leftmost = rbt.leftmost;
+    rightmost = rbt.rightmost;
+    numItems = rbt.numItems;
+    rbt.root = rbt.leftmost = rbt.rightmost = nullptr;
+    rbt.numItems = 0;
+}
+
+// Copy Assignment
+// Copies into a temporary first and then swaps, so on an exception the tree
+// is left unchanged. The tree keeps its own allocator.
+RBT_TEMPLATE
+RBT_CLASS &RBT_CLASS::operator=(const BasicRedBlackTree &rbt) {
+    if (this != &rbt) {
+        BasicRedBlackTree copy(rbt, pool.GetAllocator());
+        Swap(copy);
+    }
+    return *this;
+}
+
+// Move Assignment
+// Frees this tree and takes over the other one's nodes in O(1). If the
+// allocators neither propagate nor compare equal, the nodes cannot change
+// owner; they are moved one by one instead.
+RBT_TEMPLATE
+RBT_CLASS &RBT_CLASS::operator=(BasicRedBlackTree &&rbt) noexcept(MOVE_ASSIGN_NOEXCEPT) {
+    if (this == &rbt) return *this;
+    DestroyAll();
+    comp = rbt.comp;
+    bool canSteal = MOVE_ASSIGN_NOEXCEPT || pool.GetAllocator() == rbt.pool.GetAllocator();
+    if (canSteal) {
+        pool.TakeFrom(rbt.pool);
+        root = rbt.root;
+        leftmost = rbt.leftmost;
+        rightmost = rbt.rightmost;
+        numItems = rbt.numItems;
+        rbt.root = rbt.leftmost = rbt.rightmost = nullptr;
+        rbt.numItems = 0;
+    } else {
+        pool.Reserve(rbt.Size());
+        root = CopyOf<true>(rbt.root);
+        ResetEnds();
+        numItems = rbt.numItems;
+        rbt.DestroyAll();
+    }
+    return *this;
+}
+
+// Swap
+// Exchanges the contents of two trees in O(1).
+RBT_TEMPLATE
+void RBT_CLASS::Swap(BasicRedBlackTree &rbt) noexcept {
+    swap(comp, rbt.comp);
+    swap(root, rbt.root);
+    swap(leftmost, rbt.leftmost);
+    swap(rightmost, rbt.rightmost);
+    swap(numItems, rbt.numItems);
+    pool.Swap(rbt.pool);
+}
+
+// Range Constructor
+// Builds a balanced tree from any range of keys in O(n) once they are sorted.
+// Unsorted input or input with duplicates is sorted and deduplicated first.
+RBT_TEMPLATE
+template <class InputIt, class>
+RBT_CLASS::BasicRedBlackTree(InputIt first, InputIt last) {
+    vector<Key> keys(first, last);
+    SortUnique(keys, nullptr, 0);
+    BuildSorted(keys.data(), keys.size());
+}
+
+// Range Constructor (parallel)
+// Same as the range constructor, but sorting and building fork onto tasks
+// for runs of more than grain keys. Compare must be safe to call from
+// several threads at once.
+RBT_TEMPLATE
+template <class InputIt, class>
+RBT_CLASS::BasicRedBlackTree(InputIt first, InputIt last, TaskPool &tasks, size_t grain) {
+    vector<Key> keys(first, last);
+    SortUnique(keys, &tasks, grain);
+    BuildSorted(keys.data(), keys.size(), &tasks, grain);
+}
+
+// SortUnique
+// Sorts keys and drops repeats unless they are already strictly increasing.
+RBT_TEMPLATE
+void RBT_CLASS::SortUnique(vector<Key> &keys, TaskPool *tasks, size_t grain) {
+    auto notIncreasing = [this](const Key &a, const Key &b) { return !comp(a, b); };
+    if (adjacent_find(keys.begin(), keys.end(), notIncreasing) != keys.end()) {
+        SortKeys(keys.data(), keys.size(), tasks, grain);
+        auto same = [this](const Key &a, const Key &b) { return Equivalent(a, b); };
+        keys.erase(unique(keys.begin(), keys.end(), same), keys.end());
+    }
+}
+
+// SortKeys
+// Merge sort whose halves run as separate tasks above grain keys.
+RBT_TEMPLATE
+void RBT_CLASS::SortKeys(Key *keys, size_t count, TaskPool *tasks, size_t grain) {
+    if (tasks == nullptr || count <= grain || count < 2) {
+        sort(keys, keys + count, comp);
+        return;
+    }
+    size_t half = count / 2;
+    tasks->Invoke([&] { SortKeys(keys, half, tasks, grain); },
+                  [&] { SortKeys(keys + half, count - half, tasks, grain); });
+    inplace_merge(keys, keys + half, keys + count, comp);
+}
+
+// Destructor
+// Nodes live in the pool, so releasing its blocks frees the whole tree at once.
+RBT_TEMPLATE
+RBT_CLASS::~BasicRedBlackTree() {
+    DestroyAll();
+}
+
+// DestroyAll
+// Empties the tree and hands the pool's blocks back to the allocator.
+RBT_TEMPLATE
+void RBT_CLASS::DestroyAll() {
+    DestroyNodes(root);
+    pool.Clear();
+    root = leftmost = rightmost = nullptr;
+    numItems = 0;
+}
+
+// Clear
+// Empties the tree but keeps the pool's storage, merged into one block, so
+// refilling it up to the old size makes no allocator calls.
+RBT_TEMPLATE
+void RBT_CLASS::Clear() {
+    DestroyNodes(root);
+    pool.Recycle();
+    root = leftmost = rightmost = nullptr;
+    numItems = 0;
+}
+
+// DestroyNodes
+// Runs the destructors of every node below and including node, in postfix
+// order so no recursion or stack is needed. Nothing is visited when the key
+// and value need no destructor, since the pool then just drops the storage.
+RBT_TEMPLATE
+void RBT_CLASS::DestroyNodes(Node *node) {
+    if constexpr (!is_trivially_destructible<Node>::value) {
+        Node *n = (node != nullptr) ? const_cast<Node *>(PostfixFirst(node)) : nullptr;
+        while (n != nullptr) {
+            Node *next = (n == node) ? nullptr : const_cast<Node *>(PostfixNext(n));
+            pool.Destroy(n);
+            n = next;
+        }
+    }
+}
+
+// CopyOf
+// Deep copies the subtree under node into this tree's pool and returns the
+// copy's root. See CopySteps for the walk; the copies are allocated in
+// prefix order, next to each other once the caller has reserved the pool.
+// On an exception the partial copy is destroyed. With MoveKeys the source
+// keys and values are moved instead of copied.
+RBT_TEMPLATE
+template <bool MoveKeys>
+typename RBT_CLASS::Node *RBT_CLASS::CopyOf(conditional_t<MoveKeys, Node, const Node> *node) {
+    if (node == nullptr) return nullptr;
+    Node *top = CloneNode<MoveKeys>(node, nullptr);
+    auto *from = node;
+    Node *to = top;
+    try {
+        CopySteps<MoveKeys>(node, from, to, numeric_limits<size_t>::max());
+    } catch (...) {
+        DestroyNodes(top);
+        throw;
+    }
+    return top;
+}
+
+// CloneNode
+// Makes a detached copy of one node, color included, under parent.
+RBT_TEMPLATE
+template <bool MoveKeys>
+typename RBT_CLASS::Node *RBT_CLASS::CloneNode(conditional_t<MoveKeys, Node, const Node> *from, Node *parent) {
+    Node *copy;
+    if constexpr (MoveKeys) {
+        copy = pool.Create(move(from->data), move(from->value));
+    } else {
+        copy = pool.Create(from->data, from->value);
+    }
+    copy->color = from->color;
+    copy->IsNullNode = from->IsNullNode;
+    copy->parent = parent;
+    return copy;
+}
+
+// CopySteps
+// Continues copying the subtree under top, cloning at most budget more
+// nodes. from is the source node the walk is at and to its copy. The
+// source is walked in prefix order through its parent links, so there is
+// no recursion however deep the tree: a child still missing from the copy
+// is the next one to visit, and once both are there the walk climbs back
+// up. Returns true once the whole subtree has been copied.
+RBT_TEMPLATE
+template <bool MoveKeys>
+bool RBT_CLASS::CopySteps(conditional_t<MoveKeys, Node, const Node> *top,
+        conditional_t<MoveKeys, Node, const Node> *&from, Node *&to, size_t budget) {
+    while (true) {
+        if (from->left != nullptr && to->left == nullptr) {
+            if (budget-- == 0) return false;
+            to->left = CloneNode<MoveKeys>(from->left, to);
+            from = from->left;
+            to = to->left;
+        } else if (from->right != nullptr && to->right == nullptr) {
+            if (budget-- == 0) return false;
+            to->right = CloneNode<MoveKeys>(from->right, to);
+            from = from->right;
+            to = to->right;
+        } else {
+            UpdateSubtreeSize(to);
+            if (from == top) return true;
+            from = from->parent;
+            to = to->parent;
+        }
+    }
+}
+
+// BuildFromSorted
+// Replaces the contents of the tree with a strictly increasing range of keys
+// in linear time. Throws invalid_argument if the range is not strictly increasing.
+RBT_TEMPLATE
+template <class InputIt>
+void RBT_CLASS::BuildFromSorted(InputIt first, InputIt last) {
+    vector<Key> keys(first, last);
+    auto notIncreasing = [this](const Key &a, const Key &b) { return !comp(a, b); };
+    if (adjacent_find(keys.begin(), keys.end(), notIncreasing) != keys.end()) {
+        throw invalid_argument("Keys must be strictly increasing.");
+    }
+    BuildSorted(keys.data(), keys.size());
+}
+
+// BuildSorted
+// Replaces the tree with a perfectly balanced one holding count sorted keys.
+// Every node is black except the ones on an incomplete bottom level, which
+// are red, so all root-to-leaf paths have the same black height. With tasks
+// the two halves of every range above grain keys are built in parallel,
+// provided building a node cannot throw. The new tree is built beside the
+// old one and swapped in, so on an exception the tree is left as it was.
+RBT_TEMPLATE
+void RBT_CLASS::BuildSorted(const Key *keys, size_t count, TaskPool *tasks, size_t grain) {
+    BasicRedBlackTree built(comp, GetAllocator());
+    if (count != 0) {
+        int height = 0;
+        while ((size_t(2) << height) <= count) {
+            height++;
+        }
+        bool perfect = (count == (size_t(2) << height) - 1);
+        int redDepth = (perfect || height == 0) ? -1 : height;
+
+        if (tasks != nullptr && is_nothrow_constructible<Node, const Key &>::value) {
+            Node *slots = built.pool.TakeBlock(count);
+            built.root = built.BuildSortedSlots(keys, slots, count, 0, redDepth, nullptr, tasks, grain);
+        } else {
+            built.pool.Reserve(count);
+            built.root = built.BuildSortedRange(keys, count, 0, redDepth, nullptr);
+        }
+        built.numItems = count;
+        built.ResetEnds();
+    }
+    Swap(built);
+}
+
+// BuildSortedRange
+// Helper for BuildSorted. Makes the middle key the subtree root and recurses
+// on both halves, allocating nodes sequentially from the reserved block.
+// On an exception the part built so far is destroyed.
+RBT_TEMPLATE
+typename RBT_CLASS::Node *RBT_CLASS::BuildSortedRange(const Key *keys, size_t count, int depth, int redDepth, Node *parent) {
+    if (count == 0) return nullptr;
+    size_t mid = count / 2;
+    Node *node = pool.Create(keys[mid]);
+    node->color = (depth == redDepth) ? COLOR_RED : COLOR_BLACK;
+    node->parent = parent;
+    try {
+        node->left = BuildSortedRange(keys, mid, depth + 1, redDepth, node);
+        node->right = BuildSortedRange(keys + mid + 1, count - mid - 1, depth + 1, redDepth, node);
+    } catch (...) {
+        DestroyNodes(node);
+        throw;
+    }
+    UpdateSubtreeSize(node);
+    return node;
+}
+
+// BuildSortedSlots
+// Parallel form of BuildSortedRange. The node for keys[i] is built in
+// slots[i], so the two halves never touch the same storage or the pool.
+RBT_TEMPLATE
+typename RBT_CLASS::Node *RBT_CLASS::BuildSortedSlots(const Key *keys, Node *slots, size_t count, int depth, int redDepth,
+        Node *parent, TaskPool *tasks, size_t grain) {
+    if (count == 0) return nullptr;
+    size_t mid = count / 2;
+    Node *node = new (slots + mid) Node(keys[mid]);
+    node->color = (depth == redDepth) ? COLOR_RED : COLOR_BLACK;
+    node->parent = parent;
+    auto buildLeft = [&] {
+        node->left = BuildSortedSlots(keys, slots, mid, depth + 1, redDepth, node, tasks, grain);
+    };
+    auto buildRight = [&] {
+        node->right = BuildSortedSlots(keys + mid + 1, slots + mid + 1, count - mid - 1, depth + 1, redDepth, node, tasks, grain);
+    };
+    if (count > grain) {
+        tasks->Invoke(buildLeft, buildRight);
+    } else {
+        buildLeft();
+        buildRight();
+    }
+    UpdateSubtreeSize(node);
+    return node;
+}
+
+// Save
+// Writes the tree to path in the binary format described at RBTFileHeader:
+// the keys in order, then the values for maps. Throws runtime_error if the
+// file cannot be written.
+RBT_TEMPLATE
+void RBT_CLASS::Save(const string &path) const {
+    using Layout = TreeFileLayout<Key, Value>;
+    ofstream out(path, ios::binary | ios::trunc);
+    if (!out) throw runtime_error("Could not open " + path + " for writing.");
+
+    size_t count = Size();
+    RBTFileHeader header = Layout::Header(count);
+    const char zeros[Layout::SECTION_ALIGN] = {};
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(zeros, Layout::KeysOffset() - sizeof(header));
+
+    // Each section goes out through a fixed-size buffer, one in-order walk apiece
+    const size_t chunk = 4096;
+    auto writeSection = [&](auto field) {
+        vector<remove_cv_t<remove_reference_t<decltype(field(root))>>> buffer;
+        buffer.reserve(chunk);
+        auto flush = [&]() {
+            out.write(reinterpret_cast<const char *>(buffer.data()), buffer.size() * sizeof(buffer[0]));
+            buffer.clear();
+        };
+        ForEachNode([&](const Node *n) {
+            buffer.push_back(field(n));
+            if (buffer.size() == chunk) flush();
+        }, Traversal::Infix);
+        flush();
+    };
+    writeSection([](const Node *n) -> const Key & { return n->data; });
+    if constexpr (Layout::HAS_VALUES) {
+        out.write(zeros, Layout::ValuesOffset(count) - Layout::KeysOffset() - count * sizeof(Key));
+        writeSection([](const Node *n) -> const Value & { return n->value; });
+    }
+    if (!out.flush()) throw runtime_error("Could not write " + path + ".");
+}
+
+// Load
+// Replaces the contents of the tree with a file written by Save, rebuilding
+// it in O(n) with BuildSorted. Throws runtime_error if the file cannot be
+// read, and invalid_argument if it does not hold this tree's key and value
+// types or its keys are not strictly increasing under this tree's ordering.
+// On an exception the tree is left as it was.
+RBT_TEMPLATE
+void RBT_CLASS::Load(const string &path) {
+    using Layout = TreeFileLayout<Key, Value>;
+    ifstream in(path, ios::binary | ios::ate);
+    if (!in) throw runtime_error("Could not open " + path + " for reading.");
+    size_t fileSize = static_cast<size_t>(in.tellg());
+    in.seekg(0);
+
+    RBTFileHeader header{};
+    in.read(reinterpret_cast<char *>(&header), sizeof(header));
+    Layout::Check(header, fileSize);
+
+    vector<Key> keys(header.count);
+    vector<Value> values;
+    in.seekg(Layout::KeysOffset());
+    in.read(reinterpret_cast<char *>(keys.data()), keys.size() * sizeof(Key));
+    if constexpr (Layout::HAS_VALUES) {
+        values.resize(header.count);
+        in.seekg(Layout::ValuesOffset(header.count));
+        in.read(reinterpret_cast<char *>(values.data()), values.size() * sizeof(Value));
+    }
+    if (!in) throw runtime_error("Could not read " + path + ".");
+
+    auto notIncreasing = [this](const Key &a, const Key &b) { return !comp(a, b); };
+    if (adjacent_find(keys.begin(), keys.end(), notIncreasing) != keys.end()) {
+        throw invalid_argument("Keys must be strictly increasing.");
+    }
+    // Values are filled in on the side too, so this tree only changes once all is done
+    BasicRedBlackTree loaded(comp, GetAllocator());
+    loaded.BuildSorted(keys.data(), keys.size());
+    if constexpr (Layout::HAS_VALUES) {
+        size_t i = 0;
+        for (Node *n = (loaded.root != nullptr) ? const_cast<Node *>(InfixFirst(loaded.root)) : nullptr; n != nullptr;
+                n = const_cast<Node *>(InfixNext(n))) {
+            n->value = values[i++];
+        }
+    }
+    Swap(loaded);
+}
+
+// Freeze
+// Returns an immutable copy laid out for fast lookups, see FrozenRedBlackTree.
+// Callers need to include FrozenRedBlackTree.h.
+RBT_TEMPLATE
+FrozenRedBlackTree<Key, Value, Compare> RBT_CLASS::Freeze() const {
+    FrozenRedBlackTree<Key, Value, Compare> frozen(Size(), comp);
+    size_t slot = frozen.First();
+    ForEachNode([&](const Node *n) {
+        frozen.Place(slot, n->data, n->value);
+        slot = frozen.Next(slot);
+    }, Traversal::Infix);
+    return frozen;
+}
+
+// Insert
+// Adds a new node into the tree, maintaining Red-Black properties.
+RBT_TEMPLATE
+void RBT_CLASS::Insert(const Key &newData) {
+    if (!TryInsert(newData)) {
+        throw invalid_argument("Duplicate entry not allowed."); // No duplicate entries allowed
+    }
+}
+
+// TryInsert
+// Same as Insert, but reports a duplicate by returning false instead of throwing.
+RBT_TEMPLATE
+bool RBT_CLASS::TryInsert(const Key &newData) {
+    return BasicInsert(root, Key(newData)).second;
+}
+
+// Insert (hinted)
+// Inserts newData using hint as a starting point and returns an iterator to
+// it. Costs O(1) compares when newData goes right before hint, e.g. hint =
+// end() for increasing keys, or the iterator returned by the previous call
+// for decreasing ones, and is still correct for any hint.
+// Throws invalid_argument on a duplicate like Insert.
+RBT_TEMPLATE
+typename RBT_CLASS::const_iterator RBT_CLASS::Insert(const_iterator hint, const Key &newData) {
+    pair<const_iterator, bool> result = TryInsert(hint, newData);
+    if (!result.second) {
+        throw invalid_argument("Duplicate entry not allowed.");
+    }
+    return result.first;
+}
+
+// TryInsert (hinted)
+// Same as the hinted Insert, but on a duplicate returns the existing key's
+// iterator and false instead of throwing.
+RBT_TEMPLATE
+pair<typename RBT_CLASS::const_iterator, bool> RBT_CLASS::TryInsert(const_iterator hint, const Key &newData) {
+    pair<Node *, bool> result = BasicInsert(HintStart(hint.node, newData), Key(newData));
+    return make_pair(const_iterator(result.first, this), result.second);
+}
+
+// Emplace
+// Inserts key with a value constructed in place from args. Nothing is
+// constructed if the key is already present. Returns an iterator to the
+// key's node and whether it was inserted.
+RBT_TEMPLATE
+template <class... Args>
+pair<typename RBT_CLASS::const_iterator, bool> RBT_CLASS::Emplace(Key key, Args &&... args) {
+    pair<Node *, bool> result = BasicInsert(root, move(key), forward<Args>(args)...);
+    return make_pair(const_iterator(result.first, this), result.second);
+}
+
+// InsertMany
+// Inserts a batch of keys, sorting it first if needed. Each key's descent
+// starts from the previous key's node (see FingerStart) instead of the root,
+// so runs of neighbouring keys cost far less than one Insert each. An empty
+// tree is bulk loaded in linear time instead. Keys already present, or
+// repeated in the batch, are skipped and appended to duplicates if given.
+// Returns the number of keys inserted.
+RBT_TEMPLATE
+template <class InputIt>
+size_t RBT_CLASS::InsertMany(InputIt first, InputIt last, vector<Key> *duplicates) {
+    vector<Key> keys(first, last);
+    if (!is_sorted(keys.begin(), keys.end(), comp)) {
+        sort(keys.begin(), keys.end(), comp);
+    }
+
+    if (root == nullptr) {
+        auto kept = keys.begin();
+        for (auto it = keys.begin(); it != keys.end(); ++it) {
+            if (kept != keys.begin() && Equivalent(*prev(kept), *it)) {
+                if (duplicates != nullptr) duplicates->push_back(move(*it));
+            } else {
+                if (kept != it) *kept = move(*it);
+                ++kept;
+            }
+        }
+        keys.erase(kept, keys.end());
+        BuildSorted(keys.data(), keys.size());
+        return keys.size();
+    }
+
+    pool.Reserve(keys.size());
+    size_t inserted = 0;
+    Node *finger = nullptr;
+    for (Key &key : keys) {
+        Node *start = (finger != nullptr) ? FingerStart(finger, key) : root;
+        pair<Node *, bool> result = BasicInsert(start, move(key));
+        if (result.second) {
+            inserted++;
+        } else if (duplicates != nullptr) {
+            duplicates->push_back(move(key)); // BasicInsert leaves a duplicate key untouched
+        }
+        finger = result.first;
+    }
+    return inserted;
+}
+
+// FingerStart
+// Climbs from finger to the lowest node whose subtree must hold data's
+// position, so a descent can start there instead of at the root. Going up
+// towards a larger key only a left-child edge can bound the subtree from
+// above (and the mirror for a smaller key), so only those edges cost a
+// compare. Starting from the last node of a sorted run this stays at the
+// finger or just above it.
+RBT_TEMPLATE
+typename RBT_CLASS::Node *RBT_CLASS::FingerStart(Node *finger, const Key &data) const {
+    bool larger = comp(finger->data, data);
+    if (!larger && !comp(data, finger->data)) {
+        return finger;
+    }
+    Node *node = finger;
+    for (Node *walk = finger; walk->parent != nullptr; walk = walk->parent) {
+        Node *parent = walk->parent;
+        if (larger ? walk == parent->left : walk == parent->right) {
+            if (larger ? comp(data, parent->data) : comp(parent->data, data)) {
+                break;
+            }
+            node = parent;
+        }
+    }
+    return node;
+}
+
+// HintStart
+// Picks the node a hinted insert descends from. If data belongs right
+// before hint (end() meaning after the maximum), the gap between hint and
+// its predecessor is a free child slot of one of them, so the descent is a
+// single compare. Otherwise the hint is only treated as being near data.
+RBT_TEMPLATE
+typename RBT_CLASS::Node *RBT_CLASS::HintStart(const Node *hint, const Key &data) const {
+    if (root == nullptr) return nullptr;
+    Node *next = const_cast<Node *>(hint);
+    Node *before = const_cast<Node *>((next != nullptr) ? InfixPrev(next) : InfixLast(root));
+    bool afterBefore = (before == nullptr) || comp(before->data, data);
+    bool beforeNext = (next == nullptr) || comp(data, next->data);
+    if (afterBefore && beforeNext) {
+        return (next != nullptr && next->left == nullptr) ? next : before;
+    }
+    return FingerStart((next != nullptr) ? next : before, data);
+}
+
+// BasicInsert
+// Standard Binary Search Tree insert followed by the Red-Black fix up.
+// The descent begins at start, which is either root or a node whose subtree
+// covers newData's position. Finds the attach point and checks for a
+// duplicate in the same descent. A new smallest key can only attach left of
+// leftmost, and a new largest right of rightmost. Returns the key's node and true if it was
+// inserted, or the existing node and false if the key was already present
+// (newData is then left as it was).
+RBT_TEMPLATE
+template <class... Args>
+pair<typename RBT_CLASS::Node *, bool> RBT_CLASS::BasicInsert(Node *start, Key &&newData, Args &&... args) {
+    Node *curr = start;
+    Node *parent = nullptr;
+    bool goLeft = false;
+
+    RBT_COUNT(insertDescents, 1);
+    while (curr != nullptr) {
+        RBT_COUNT(insertComparisons, 1);
+        if constexpr (FAST_COMPARE) {
+            if (newData == curr->data) {
+                return make_pair(curr, false);
+            }
+            goLeft = newData < curr->data;
+        } else {
+            goLeft = comp(newData, curr->data);
+            if (!goLeft && !comp(curr->data, newData)) {
+                return make_pair(curr, false);
+            }
+        }
+        parent = curr;
+        curr = goLeft ? curr->left : curr->right;
+    }
+
+    Node *node = pool.Create(move(newData), forward<Args>(args)...);
+    node->color = COLOR_RED; // New nodes are always inserted as red first
+    node->parent = parent;
+    if (parent == nullptr) {
+        root = node;  // New node becomes the root
+        leftmost = rightmost = node;
+    } else if (goLeft) {
+        parent->left = node;
+        if (parent == leftmost) leftmost = node;
+    } else {
+        parent->right = node;
+        if (parent == rightmost) rightmost = node;
+    }
+
+    // The new leaf adds one key to every subtree on the path above it
+    if constexpr (OrderStatistics) {
+        for (Node *p = parent; p != nullptr; p = p->parent) {
+            p->subtreeSize++;
+        }
+    }
+
+    InsertFixUp(node, root); // Fix any Red-Black violations after insert
+    numItems++;
+    return make_pair(node, true);
+}
+
+// InsertFixUp
+// Fixes Red-Black Tree properties after insertion by rotating/recoloring.
+// top is the root of the tree being fixed, normally root.
+// Returns true if the root had to be turned black, i.e. the black height grew.
+RBT_TEMPLATE
+bool RBT_CLASS::InsertFixUp(Node *node, Node *&top) {
+    while (node->parent != nullptr && node->parent->color == COLOR_RED) {
+        Node *uncle = GetUncle(node);
+        Node *grandparent = node->parent->parent;
+
+        if (uncle != nullptr && uncle->color == COLOR_RED) {
+            // Case 1: Parent and Uncle are both red - recolor and move up the tree
+            RBT_COUNT(insertRecolorCases, 1);
+            RBT_COUNT(recolors, 3);
+            node->parent->color = COLOR_BLACK;
+            uncle->color = COLOR_BLACK;
+            grandparent->color = COLOR_RED;
+            node = grandparent;
+        } else {
+            // Cases 2 and 3: Rotation cases
+            if (IsLeftChild(node) && IsLeftChild(node->parent)) {
+                RBT_COUNT(insertOuterRotations, 1);
+                RBT_COUNT(recolors, 2);
+                RightRotate(grandparent, top);
+                node->parent->color = COLOR_BLACK;
+                grandparent->color = COLOR_RED;
+            } else if (IsRightChild(node) && IsRightChild(node->parent)) {
+                RBT_COUNT(insertOuterRotations, 1);
+                RBT_COUNT(recolors, 2);
+                LeftRotate(grandparent, top);
+                node->parent->color = COLOR_BLACK;
+                grandparent->color = COLOR_RED;
+            } else if (IsLeftChild(node) && IsRightChild(node->parent)) {
+                RBT_COUNT(insertInnerRotations, 1);
+                RightRotate(node->parent, top);
+                node = node->right;
+            } else {
+                RBT_COUNT(insertInnerRotations, 1);
+                LeftRotate(node->parent, top);
+                node = node->left;
+            }
+        }
+    }
+    bool grew = (top->color == COLOR_RED);
+    RBT_COUNT(recolors, grew);
+    top->color = COLOR_BLACK; // Always reassert root is black
+    return grew;
+}
+
+// Remove
+// Deletes a key from the tree, maintaining Red-Black properties.
+// Returns false if the key was not present.
+RBT_TEMPLATE
+bool RBT_CLASS::Remove(const Key &data) {
+    Node *node = Get(data);
+    if (node == nullptr) {
+        return false;
+    }
+    RemoveNode(node);
+    return true;
+}
+
+// Erase
+// Deletes the key an iterator points to and returns an iterator to the next key.
+RBT_TEMPLATE
+typename RBT_CLASS::const_iterator RBT_CLASS::Erase(const_iterator pos) {
+    Node *node = const_cast<Node *>(pos.node);
+    const Node *next = InfixNext(node);
+    RemoveNode(node);
+    return const_iterator(next, this);
+}
+
+// PopMin
+// Removes and returns the smallest key, the cached leftmost node, so no
+// descent is needed. Throws underflow_error if the tree is empty.
+RBT_TEMPLATE
+Key RBT_CLASS::PopMin() {
+    if (root == nullptr) throw underflow_error("Tree is empty.");
+    Node *node = leftmost;
+    Key key = move(node->data);
+    RemoveNode(node);
+    return key;
+}
+
+// PopMax
+// Removes and returns the largest key, the cached rightmost node. Throws
+// underflow_error if the tree is empty.
+RBT_TEMPLATE
+Key RBT_CLASS::PopMax() {
+    if (root == nullptr) throw underflow_error("Tree is empty.");
+    Node *node = rightmost;
+    Key key = move(node->data);
+    RemoveNode(node);
+    return key;
+}
+
+// RemoveNode
+// Standard Binary Search Tree delete followed by the Red-Black fix up.
+// A node with two children is replaced by its successor node (the node
+// itself moves, nothing is copied), so iterators to other keys stay valid.
+// The removed node goes back to the pool for reuse. Rotations keep every
+// node's in-order neighbours, so only removing an end node moves an end.
+RBT_TEMPLATE
+void RBT_CLASS::RemoveNode(Node *node) {
+    if (node == leftmost) leftmost = const_cast<Node *>(InfixNext(node));
+    if (node == rightmost) rightmost = const_cast<Node *>(InfixPrev(node));
+    unsigned short int removedColor = node->color;
+    Node *child;        // node that moves into the removed position, may be nullptr
+    Node *childParent;  // its parent after the move, needed when child is nullptr
+
+    if (node->left == nullptr) {
+        child = node->right;
+        childParent = node->parent;
+        Transplant(node, node->right);
+    } else if (node->right == nullptr) {
+        child = node->left;
+        childParent = node->parent;
+        Transplant(node, node->left);
+    } else {
+        Node *successor = const_cast<Node *>(InfixFirst(node->right));
+        removedColor = successor->color;
+        child = successor->right;
+        if (successor->parent == node) {
+            childParent = successor;
+        } else {
+            childParent = successor->parent;
+            Transplant(successor, successor->right);
+            successor->right = node->right;
+            successor->right->parent = successor;
+        }
+        Transplant(node, successor);
+        successor->left = node->left;
+        successor->left->parent = successor;
+        successor->color = node->color;
+    }
+
+    // Every subtree whose size changed lies on the path from childParent to the root
+    if constexpr (OrderStatistics) {
+        for (Node *p = childParent; p != nullptr; p = p->parent) {
+            UpdateSubtreeSize(p);
+        }
+    }
+
+    pool.Destroy(node);
+    numItems--;
+
+    if (removedColor == COLOR_BLACK) {
+        RemoveFixUp(child, childParent);
+    }
+}
+
+// RemoveFixUp
+// Restores the black height after a black node was removed. node carries the
+// extra black and may be nullptr, so its parent is passed separately.
+RBT_TEMPLATE
+void RBT_CLASS::RemoveFixUp(Node *node, Node *parent) {
+    while (node != root && IsBlack(node)) {
+        if (node == parent->left) {
+            Node *sibling = parent->right;
+            if (!IsBlack(sibling)) {
+                // Case 1: red sibling - rotate so the sibling is black
+                RBT_COUNT(removeCase1, 1);
+                RBT_COUNT(recolors, 2);
+                sibling->color = COLOR_BLACK;
+                parent->color = COLOR_RED;
+                LeftRotate(parent, root);
+                sibling = parent->right;
+            }
+            if (IsBlack(sibling->left) && IsBlack(sibling->right)) {
+                // Case 2: both nephews black - recolor and move up the tree
+                RBT_COUNT(removeCase2, 1);
+                RBT_COUNT(recolors, 1);
+                sibling->color = COLOR_RED;
+                node = parent;
+                parent = node->parent;
+            } else {
+                if (IsBlack(sibling->right)) {
+                    // Case 3: near nephew red - rotate it into the far position
+                    RBT_COUNT(removeCase3, 1);
+                    RBT_COUNT(recolors, 2);
+                    sibling->left->color = COLOR_BLACK;
+                    sibling->color = COLOR_RED;
+                    RightRotate(sibling, root);
+                    sibling = parent->right;
+                }
+                // Case 4: far nephew red - rotate and finish
+                RBT_COUNT(removeCase4, 1);
+                RBT_COUNT(recolors, 3);
+                sibling->color = parent->color;
+                parent->color = COLOR_BLACK;
+                sibling->right->color = COLOR_BLACK;
+                LeftRotate(parent, root);
+                node = root;
+                parent = nullptr;
+            }
+        } else {
+            Node *sibling = parent->left;
+            if (!IsBlack(sibling)) {
+                RBT_COUNT(removeCase1, 1);
+                RBT_COUNT(recolors, 2);
+                sibling->color = COLOR_BLACK;
+                parent->color = COLOR_RED;
+                RightRotate(parent, root);
+                sibling = parent->left;
+            }
+            if (IsBlack(sibling->left) && IsBlack(sibling->right)) {
+                RBT_COUNT(removeCase2, 1);
+                RBT_COUNT(recolors, 1);
+                sibling->color = COLOR_RED;
+                node = parent;
+                parent = node->parent;
+            } else {
+                if (IsBlack(sibling->left)) {
+                    RBT_COUNT(removeCase3, 1);
+                    RBT_COUNT(recolors, 2);
+                    sibling->right->color = COLOR_BLACK;
+                    sibling->color = COLOR_RED;
+                    LeftRotate(sibling, root);
+                    sibling = parent->left;
+                }
+                RBT_COUNT(removeCase4, 1);
+                RBT_COUNT(recolors, 3);
+                sibling->color = parent->color;
+                parent->color = COLOR_BLACK;
+                sibling->left->color = COLOR_BLACK;
+                RightRotate(parent, root);
+                node = root;
+                parent = nullptr;
+            }
+        }
+    }
+    if (node != nullptr) {
+        RBT_COUNT(recolors, node->color != COLOR_BLACK);
+        node->color = COLOR_BLACK;
+    }
+}
+
+// Transplant
+// Puts replacement (may be nullptr) where node hangs under its parent.
+RBT_TEMPLATE
+void RBT_CLASS::Transplant(Node *node, Node *replacement) {
+    if (node->parent == nullptr) {
+        root = replacement;
+    } else if (node == node->parent->left) {
+        node->parent->left = replacement;
+    } else {
+        node->parent->right = replacement;
+    }
+    if (replacement != nullptr) {
+        replacement->parent = node->parent;
+    }
+}
+
+// Join
+// Appends every key of greater, which must all be larger than this tree's
+// keys, in O(log n). greater's nodes are taken over rather than copied and
+// it is left empty. Throws invalid_argument if the key ranges overlap.
+RBT_TEMPLATE
+void RBT_CLASS::Join(BasicRedBlackTree &&greater) {
+    if (&greater == this || greater.root == nullptr) return;
+    if (root != nullptr && !comp(GetMax(), greater.GetMin())) {
+        throw invalid_argument("Joined keys must all be greater than this tree's keys.");
+    }
+    Subtree right = AdoptNodes(greater);
+    SetRoot(JoinSubtrees(Subtree{root, BlackHeight(root)}, right));
+}
+
+// Split
+// Keeps the keys less than key and returns a tree with the rest, in
+// O(log n). No node is copied or moved: the returned tree shares this
+// tree's pool blocks (see NodePool::Share), so iterators into either half
+// stay valid, and the blocks are freed once both trees are gone. The
+// ranked tree reads both sizes off its subtree sizes, so it splits in
+// O(log n). The plain tree keeps none: it walks both halves in step until
+// the smaller one ends, which costs O(log n + min(|less|, |greater|)), and
+// the other half's size is what is left of the old total.
+RBT_TEMPLATE
+RBT_CLASS RBT_CLASS::Split(const Key &key) {
+    BasicRedBlackTree greater(comp, GetAllocator());
+    if (root == nullptr || comp(GetMax(), key)) return greater;
+    if (!comp(GetMin(), key)) {
+        Swap(greater);
+        return greater;
+    }
+
+    pool.Share(greater.pool);
+    Subtree less, more;
+    Node *equal = SplitSubtree(Subtree{root, BlackHeight(root)}, key, less, more);
+    if (equal != nullptr) {
+        more = JoinSubtrees(Subtree{nullptr, 0}, equal, more);
+    }
+    size_t total = numItems;
+    SetRoot(less);
+    greater.SetRoot(more);
+    if constexpr (OrderStatistics) {
+        numItems = SubtreeSize(root);
+    } else {
+        const Node *a = leftmost;
+        const Node *b = greater.leftmost;
+        size_t smaller = 0;
+        while (a != nullptr && b != nullptr) {
+            a = InfixNext(a);
+            b = InfixNext(b);
+            smaller++;
+        }
+        numItems = (a == nullptr) ? smaller : total - smaller;
+    }
+    greater.numItems = total - numItems;
+    return greater;
+}
+
+// Union
+// Adds every key of other to this tree, taking over other's nodes instead
+// of allocating new ones, and leaves other empty. Where both trees hold a
+// key this tree's node and value are kept. Runs in O(m log(n/m + 1)) for
+// trees of sizes m <= n.
+RBT_TEMPLATE
+void RBT_CLASS::Union(BasicRedBlackTree &&other) {
+    CombineWith(SetOperation::Union, other, nullptr, 0);
+}
+
+// Intersection
+// Keeps only the keys that other also holds and leaves other empty. The
+// nodes that survive are this tree's own, so their values are kept.
+RBT_TEMPLATE
+void RBT_CLASS::Intersection(BasicRedBlackTree &&other) {
+    CombineWith(SetOperation::Intersection, other, nullptr, 0);
+}
+
+// Difference
+// Removes every key that other holds and leaves other empty.
+RBT_TEMPLATE
+void RBT_CLASS::Difference(BasicRedBlackTree &&other) {
+    CombineWith(SetOperation::Difference, other, nullptr, 0);
+}
+
+// Union / Intersection / Difference (parallel)
+// Same results, but the two halves of every subproblem holding more than
+// about grain of other's keys are run as separate tasks on tasks. Compare
+// must be safe to call from several threads at once.
+RBT_TEMPLATE
+void RBT_CLASS::Union(BasicRedBlackTree &&other, TaskPool &tasks, size_t grain) {
+    CombineWith(SetOperation::Union, other, &tasks, grain);
+}
+
+RBT_TEMPLATE
+void RBT_CLASS::Intersection(BasicRedBlackTree &&other, TaskPool &tasks, size_t grain) {
+    CombineWith(SetOperation::Intersection, other, &tasks, grain);
+}
+
+RBT_TEMPLATE
+void RBT_CLASS::Difference(BasicRedBlackTree &&other, TaskPool &tasks, size_t grain) {
+    CombineWith(SetOperation::Difference, other, &tasks, grain);
+}
+
+// CombineWith
+// Shared body of the set operations. The recursion only collects the nodes
+// it drops; they go back to the pool afterwards on this thread, since the
+// pool is not thread safe.
+RBT_TEMPLATE
+void RBT_CLASS::CombineWith(SetOperation operation, BasicRedBlackTree &other, TaskPool *tasks, size_t grain) {
+    if (&other == this) {
+        if (operation == SetOperation::Difference) DestroyAll();
+        return;
+    }
+    Subtree b = AdoptNodes(other);
+    vector<Node *> dropped;
+    SetRoot(CombineSubtrees(operation, Subtree{root, BlackHeight(root)}, b, dropped, tasks, ForkHeight(grain)));
+    for (Node *node : dropped) {
+        DiscardSubtree(node);
+    }
+}
+
+// CombineSubtrees
+// Splits a around b's root, combines the halves with b's subtrees and joins
+// the results back together. The halves are forked onto tasks while b's
+// black height is at least forkHeight. Nodes that leave the result are
+// appended to dropped as detached subtrees; on a shared key a's node is
+// the one kept.
+RBT_TEMPLATE
+typename RBT_CLASS::Subtree RBT_CLASS::CombineSubtrees(SetOperation operation, Subtree a, Subtree b,
+        vector<Node *> &dropped, TaskPool *tasks, int forkHeight) {
+    if (a.root == nullptr || b.root == nullptr) {
+        if (operation == SetOperation::Union) {
+            return (a.root != nullptr) ? a : b;
+        }
+        if (b.root != nullptr) dropped.push_back(b.root);
+        if (operation == SetOperation::Difference) {
+            return a;
+        }
+        if (a.root != nullptr) dropped.push_back(a.root);
+        return Subtree{nullptr, 0};
+    }
+
+    Node *pivot = b.root;
+    Subtree bLeft, bRight, aLeft, aRight;
+    Unlink(pivot, b.blackHeight, bLeft, bRight);
+    Node *equal = SplitSubtree(a, pivot->data, aLeft, aRight);
+
+    Subtree left, right;
+    if (tasks != nullptr && b.blackHeight >= forkHeight) {
+        vector<Node *> rightDropped;
+        tasks->Invoke(
+            [&] { left = CombineSubtrees(operation, aLeft, bLeft, dropped, tasks, forkHeight); },
+            [&] { right = CombineSubtrees(operation, aRight, bRight, rightDropped, tasks, forkHeight); });
+        dropped.insert(dropped.end(), rightDropped.begin(), rightDropped.end());
+    } else {
+        left = CombineSubtrees(operation, aLeft, bLeft, dropped, tasks, forkHeight);
+        right = CombineSubtrees(operation, aRight, bRight, dropped, tasks, forkHeight);
+    }
+
+    if (operation == SetOperation::Union) {
+        if (equal != nullptr) {
+            dropped.push_back(pivot);
+            pivot = equal;
+        }
+        return JoinSubtrees(left, pivot, right);
+    }
+    dropped.push_back(pivot);
+    if (operation == SetOperation::Intersection && equal != nullptr) {
+        return JoinSubtrees(left, equal, right);
+    }
+    if (equal != nullptr) dropped.push_back(equal);
+    return JoinSubtrees(left, right);
+}
+
+// ForkHeight
+// Smallest black height whose subtrees are sure to hold grain keys, since
+// a subtree of black height h has at least 2^h - 1 nodes.
+RBT_TEMPLATE
+int RBT_CLASS::ForkHeight(size_t grain) {
+    int height = 0;
+    while (height < 64 && (size_t(1) << height) - 1 < grain) {
+        height++;
+    }
+    return height;
+}
+
+// AdoptNodes
+// Moves all of other's nodes into this tree's pool and returns them as a
+// detached subtree, leaving other empty. With equal allocators the pool
+// blocks just change owner; otherwise the nodes are moved one by one.
+// numItems counts the adopted keys until the caller discards any.
+RBT_TEMPLATE
+typename RBT_CLASS::Subtree RBT_CLASS::AdoptNodes(BasicRedBlackTree &other) {
+    Subtree tree{other.root, BlackHeight(other.root)};
+    size_t count = other.numItems;
+    if (pool.GetAllocator() == other.pool.GetAllocator()) {
+        pool.Splice(other.pool);
+        other.root = other.leftmost = other.rightmost = nullptr;
+        other.numItems = 0;
+    } else {
+        pool.Reserve(count);
+        tree.root = CopyOf<true>(other.root);
+        other.DestroyAll();
+    }
+    numItems += count;
+    return tree;
+}
+
+// SetRoot
+// Installs the result of a set operation as the whole tree. A subtree may
+// have a red root, which only needs recoloring.
+RBT_TEMPLATE
+void RBT_CLASS::SetRoot(Subtree tree) {
+    root = tree.root;
+    if (root != nullptr) {
+        root->parent = nullptr;
+        root->color = COLOR_BLACK;
+    } else {
+        numItems = 0;
+    }
+    ResetEnds();
+}
+
+// BlackHeight
+// Number of black nodes on any path from node down to a leaf.
+RBT_TEMPLATE
+int RBT_CLASS::BlackHeight(const Node *node) {
+    int height = 0;
+    for (; node != nullptr; node = node->left) {
+        if (node->color == COLOR_BLACK) height++;
+    }
+    return height;
+}
+
+// Unlink
+// Detaches node's children as subtrees of their own. A child's black height
+// is node's minus one if node is black, whatever the child's color.
+RBT_TEMPLATE
+void RBT_CLASS::Unlink(Node *node, int blackHeight, Subtree &left, Subtree &right) {
+    int childHeight = blackHeight - (node->color == COLOR_BLACK ? 1 : 0);
+    left = Subtree{node->left, childHeight};
+    right = Subtree{node->right, childHeight};
+    if (node->left) node->left->parent = nullptr;
+    if (node->right) node->right->parent = nullptr;
+    node->left = nullptr;
+    node->right = nullptr;
+}
+
+// JoinSubtrees
+// Joins left, middle and right, whose keys are in that order, into one
+// valid subtree in O(|difference in black height| + 1). middle is hung red
+// at the spot on the taller tree's inner spine where the black heights
+// match and the usual insert fix up repairs that path.
+RBT_TEMPLATE
+typename RBT_CLASS::Subtree RBT_CLASS::JoinSubtrees(Subtree left, Node *middle, Subtree right) {
+    // A red root would clash with the red middle, so blacken it first
+    if (left.root != nullptr && left.root->color == COLOR_RED) {
+        left.root->color = COLOR_BLACK;
+        left.blackHeight++;
+    }
+    if (right.root != nullptr && right.root->color == COLOR_RED) {
+        right.root->color = COLOR_BLACK;
+        right.blackHeight++;
+    }
+
+    middle->parent = nullptr;
+    if (left.blackHeight == right.blackHeight) {
+        middle->color = COLOR_BLACK;
+        middle->left = left.root;
+        middle->right = right.root;
+        if (left.root) left.root->parent = middle;
+        if (right.root) right.root->parent = middle;
+        UpdateSubtreeSize(middle);
+        return Subtree{middle, left.blackHeight + 1};
+    }
+
+    bool leftTaller = left.blackHeight > right.blackHeight;
+    Subtree tall = leftTaller ? left : right;
+    Subtree shorter = leftTaller ? right : left;
+
+    // Walk down the side facing the shorter tree to a black node of its height
+    Node *parent = nullptr;
+    Node *curr = tall.root;
+    int height = tall.blackHeight;
+    while (!(IsBlack(curr) && height == shorter.blackHeight)) {
+        if (curr->color == COLOR_BLACK) height--;
+        parent = curr;
+        curr = leftTaller ? curr->right : curr->left;
+    }
+
+    middle->color = COLOR_RED;
+    middle->parent = parent;
+    if (leftTaller) {
+        middle->left = curr;
+        middle->right = shorter.root;
+        parent->right = middle;
+    } else {
+        middle->left = shorter.root;
+        middle->right = curr;
+        parent->left = middle;
+    }
+    if (curr) curr->parent = middle;
+    if (shorter.root) shorter.root->parent = middle;
+
+    if constexpr (OrderStatistics) {
+        for (Node *p = middle; p != nullptr; p = p->parent) {
+            UpdateSubtreeSize(p);
+        }
+    }
+
+    Node *top = tall.root;
+    bool grew = InsertFixUp(middle, top);
+    return Subtree{top, tall.blackHeight + (grew ? 1 : 0)};
+}
+
+// JoinSubtrees
+// Joins two subtrees whose keys are in order, using left's largest node as
+// the middle.
+RBT_TEMPLATE
+typename RBT_CLASS::Subtree RBT_CLASS::JoinSubtrees(Subtree left, Subtree right) {
+    if (left.root == nullptr) return right;
+    Subtree rest;
+    Node *last = SplitLast(left, rest);
+    return JoinSubtrees(rest, last, right);
+}
+
+// SplitSubtree
+// Cuts tree into the keys less than key and the keys greater than it in
+// O(log n). Returns the detached node holding key, or nullptr if there is none.
+RBT_TEMPLATE
+typename RBT_CLASS::Node *RBT_CLASS::SplitSubtree(Subtree tree, const Key &key, Subtree &less, Subtree &greater) {
+    if (tree.root == nullptr) {
+        less = greater = Subtree{nullptr, 0};
+        return nullptr;
+    }
+    Node *node = tree.root;
+    Subtree left, right;
+    Unlink(node, tree.blackHeight, left, right);
+
+    if (comp(key, node->data)) {
+        Subtree middle;
+        Node *equal = SplitSubtree(left, key, less, middle);
+        greater = JoinSubtrees(middle, node, right);
+        return equal;
+    }
+    if (comp(node->data, key)) {
+        Subtree middle;
+        Node *equal = SplitSubtree(right, key, middle, greater);
+        less = JoinSubtrees(left, node, middle);
+        return equal;
+    }
+    less = left;
+    greater = right;
+    return node;
+}
+
+// SplitLast
+// Detaches and returns the largest node of tree; rest receives the others.
+RBT_TEMPLATE
+typename RBT_CLASS::Node *RBT_CLASS::SplitLast(Subtree tree, Subtree &rest) {
+    Node *node = tree.root;
+    Subtree left, right;
+    Unlink(node, tree.blackHeight, left, right);
+    if (right.root == nullptr) {
+        rest = left;
+        return node;
+    }
+    Subtree remaining;
+    Node *last = SplitLast(right, remaining);
+    rest = JoinSubtrees(left, node, remaining);
+    return last;
+}
+
+// Discard
+// Returns a node that a set operation dropped to the pool.
+RBT_TEMPLATE
+void RBT_CLASS::Discard(Node *node) {
+    pool.Destroy(node);
+    numItems--;
+}
+
+// DiscardSubtree
+// Discards every node below and including node.
+RBT_TEMPLATE
+void RBT_CLASS::DiscardSubtree(Node *node) {
+    if (node == nullptr) return;
+    node->parent = nullptr;
+    Node *n = const_cast<Node *>(PostfixFirst(node));
+    while (n != nullptr) {
+        Node *next = const_cast<Node *>(PostfixNext(n));
+        Discard(n);
+        n = next;
+    }
+}
+
+// LeftRotate
+// Performs a left rotation around a given node. top is updated if node was
+// the root of its tree.
+RBT_TEMPLATE
+void RBT_CLASS::LeftRotate(Node *node, Node *&top) {
+    RBT_COUNT(leftRotations, 1);
+    Node *rightChild = node->right;
+    node->right = rightChild->left;
+    if (rightChild->left != nullptr) {
+        rightChild->left->parent = node;
+    }
+    rightChild->parent = node->parent;
+    if (node->parent == nullptr) {
+        top = rightChild;
+    } else if (node == node->parent->left) {
+        node->parent->left = rightChild;
+    } else {
+        node->parent->right = rightChild;
+    }
+    rightChild->left = node;
+    node->parent = rightChild;
+    if constexpr (OrderStatistics) {
+        rightChild->subtreeSize = node->subtreeSize;
+        UpdateSubtreeSize(node);
+    }
+}
+
+// RightRotate
+// Performs a right rotation around a given node. top is updated if node was
+// the root of its tree.
+RBT_TEMPLATE
+void RBT_CLASS::RightRotate(Node *node, Node *&top) {
+    RBT_COUNT(rightRotations, 1);
+    Node *leftChild = node->left;
+    node->left = leftChild->right;
+    if (leftChild->right != nullptr) {
+        leftChild->right->parent = node;
+    }
+    leftChild->parent = node->parent;
+    if (node->parent == nullptr) {
+        top = leftChild;
+    } else if (node == node->parent->left) {
+        node->parent->left = leftChild;
+    } else {
+        node->parent->right = leftChild;
+    }
+    leftChild->right = node;
+    node->parent = leftChild;
+    if constexpr (OrderStatistics) {
+        leftChild->subtreeSize = node->subtreeSize;
+        UpdateSubtreeSize(node);
+    }
+}
+
+// GetUncle
+// Finds and returns the uncle of a node (may return nullptr if no uncle).
+RBT_TEMPLATE
+typename RBT_CLASS::Node *RBT_CLASS::GetUncle(Node *node) const {
+    Node *grandparent = node->parent ? node->parent->parent : nullptr;
+    if (grandparent == nullptr) return nullptr;
+    if (grandparent->left == node->parent) return grandparent->right;
+    return grandparent->left;
+}
+
+// IsLeftChild
+// Returns true if node is a left child.
+RBT_TEMPLATE
+bool RBT_CLASS::IsLeftChild(Node *node) const {
+    return node->parent && node == node->parent->left;
+}
+
+// IsRightChild
+// Returns true if node is a right child.
+RBT_TEMPLATE
+bool RBT_CLASS::IsRightChild(Node *node) const {
+    return node->parent && node == node->parent->right;
+}
+
+// Contains
+// Returns true if the tree contains a given value.
+RBT_TEMPLATE
+bool RBT_CLASS::Contains(const Key &data) const {
+    return (Get(data) != nullptr);
+}
+
+// Get
+// Returns the node with given data, or nullptr if not found.
+RBT_TEMPLATE
+typename RBT_CLASS::Node *RBT_CLASS::Get(const Key &data) const {
+    Node *curr = root;
+    RBT_COUNT(searches, 1);
+    while (curr != nullptr) {
+        RBT_COUNT(searchComparisons, 1);
+        if constexpr (FAST_COMPARE) {
+            if (data == curr->data) {
+                return curr;
+            }
+            curr = (data < curr->data) ? curr->left : curr->right;
+        } else {
+            if (comp(data, curr->data)) {
+                curr = curr->left;
+            } else if (comp(curr->data, data)) {
+                curr = curr->right;
+            } else {
+                return curr;
+            }
+        }
+    }
+    return nullptr;
+}
+
+// ContainsMany
+// Batched Contains: found[i] is set to whether keys[i] is in the tree.
+RBT_TEMPLATE
+void RBT_CLASS::ContainsMany(const Key *keys, size_t count, bool *found) const {
+    GetMany(keys, count, [found](size_t i, const Node *node) { found[i] = (node != nullptr); });
+}
+
+RBT_TEMPLATE
+void RBT_CLASS::ContainsMany(const vector<Key> &keys, vector<bool> &found) const {
+    found.assign(keys.size(), false);
+    GetMany(keys.data(), keys.size(), [&found](size_t i, const Node *node) { found[i] = (node != nullptr); });
+}
+
+// FindMany
+// Batched Find: found[i] is an iterator to keys[i], or end() if it is missing.
+RBT_TEMPLATE
+void RBT_CLASS::FindMany(const Key *keys, size_t count, const_iterator *found) const {
+    GetMany(keys, count, [this, found](size_t i, const Node *node) { found[i] = const_iterator(node, this); });
+}
+
+// GetMany
+// Walks LOOKUP_LANES lookups down the tree side by side. Each round moves
+// every unfinished lookup one level and prefetches the child it will read
+// next, so the cache misses of different lookups overlap instead of being
+// paid one after another. Built-in keys take the same single compare per
+// level as Get. Calls emit(i, node) once per key, with node nullptr if
+// keys[i] is not in the tree.
+RBT_TEMPLATE
+template <class Emit>
+void RBT_CLASS::GetMany(const Key *keys, size_t count, Emit emit) const {
+    const Node *cursor[LOOKUP_LANES];
+    for (size_t base = 0; base < count; base += LOOKUP_LANES) {
+        size_t lanes = min(LOOKUP_LANES, count - base);
+        size_t pending = lanes;
+        RBT_COUNT(searches, lanes);
+        for (size_t i = 0; i < lanes; i++) {
+            cursor[i] = root;
+            if (root == nullptr) emit(base + i, nullptr);
+        }
+        if (root == nullptr) continue;
+
+        while (pending > 0) {
+            for (size_t i = 0; i < lanes; i++) {
+                const Node *n = cursor[i];
+                if (n == nullptr) continue;
+                const Key &key = keys[base + i];
+                const Node *next;
+                RBT_COUNT(searchComparisons, 1);
+                bool hit;
+                if constexpr (FAST_COMPARE) {
+                    hit = (key == n->data);
+                    next = (key < n->data) ? n->left : n->right;
+                } else {
+                    bool goLeft = comp(key, n->data);
+                    hit = !goLeft && !comp(n->data, key);
+                    next = goLeft ? n->left : n->right;
+                }
+                if (hit) {
+                    emit(base + i, n);
+                    cursor[i] = nullptr;
+                    pending--;
+                    continue;
+                }
+                if (next == nullptr) {
+                    emit(base + i, nullptr);
+                    pending--;
+                } else {
+                    RBT_PREFETCH(next);
+                }
+                cursor[i] = next;
+            }
+        }
+    }
+}
+
+// GetValue
+// Returns a pointer to the value stored with data, or nullptr if not found.
+RBT_TEMPLATE
+Value *RBT_CLASS::GetValue(const Key &data) {
+    Node *node = Get(data);
+    return (node != nullptr) ? &node->value : nullptr;
+}
+
+RBT_TEMPLATE
+const Value *RBT_CLASS::GetValue(const Key &data) const {
+    const Node *node = Get(data);
+    return (node != nullptr) ? &node->value : nullptr;
+}
+
+// At
+// Returns the value stored with data. Throws out_of_range if not found.
+RBT_TEMPLATE
+Value &RBT_CLASS::At(const Key &data) {
+    Value *value = GetValue(data);
+    if (value == nullptr) throw out_of_range("Key not found.");
+    return *value;
+}
+
+RBT_TEMPLATE
+const Value &RBT_CLASS::At(const Key &data) const {
+    const Value *value = GetValue(data);
+    if (value == nullptr) throw out_of_range("Key not found.");
+    return *value;
+}
+
+// GetMin
+// Returns the minimum data value in the tree in O(1), from the cached leftmost node.
+RBT_TEMPLATE
+const Key &RBT_CLASS::GetMin() const {
+    if (root == nullptr) throw underflow_error("Tree is empty.");
+    return leftmost->data;
+}
+
+// GetMax
+// Returns the maximum data value in the tree in O(1), from the cached rightmost node.
+RBT_TEMPLATE
+const Key &RBT_CLASS::GetMax() const {
+    if (root == nullptr) throw underflow_error("Tree is empty.");
+    return rightmost->data;
+}
+
+// ResetEnds
+// Recomputes leftmost and rightmost after the whole tree was replaced.
+RBT_TEMPLATE
+void RBT_CLASS::ResetEnds() {
+    leftmost = (root != nullptr) ? const_cast<Node *>(InfixFirst(root)) : nullptr;
+    rightmost = (root != nullptr) ? const_cast<Node *>(InfixLast(root)) : nullptr;
+}
+
+// GetStats
+// Returns the counters gathered so far together with the tree's current
+// shape: its depth, average key depth and black height, measured by an
+// O(n) walk with an explicit stack. The walk also checks that the black
+// root, red-red and black height rules hold.
+RBT_TEMPLATE
+RBTStats RBT_CLASS::GetStats() const {
+    RBTStats result;
+#ifdef RBT_ENABLE_STATS
+    result.countersEnabled = true;
+    result.searches = stats.searches.load(memory_order_relaxed);
+    result.searchComparisons = stats.searchComparisons.load(memory_order_relaxed);
+    result.insertDescents = stats.insertDescents.load(memory_order_relaxed);
+    result.insertComparisons = stats.insertComparisons.load(memory_order_relaxed);
+    result.insertRecolorCases = stats.insertRecolorCases.load(memory_order_relaxed);
+    result.insertOuterRotations = stats.insertOuterRotations.load(memory_order_relaxed);
+    result.insertInnerRotations = stats.insertInnerRotations.load(memory_order_relaxed);
+    result.removeCases[0] = stats.removeCase1.load(memory_order_relaxed);
+    result.removeCases[1] = stats.removeCase2.load(memory_order_relaxed);
+    result.removeCases[2] = stats.removeCase3.load(memory_order_relaxed);
+    result.removeCases[3] = stats.removeCase4.load(memory_order_relaxed);
+    result.leftRotations = stats.leftRotations.load(memory_order_relaxed);
+    result.rightRotations = stats.rightRotations.load(memory_order_relaxed);
+    result.recolors = stats.recolors.load(memory_order_relaxed);
+#endif
+    if (root == nullptr) return result;
+
+    struct Visit {
+        const Node *node;
+        size_t depth;
+        int blacks;   // black nodes from the root down to node, itself included
+    };
+    vector<Visit> pending;
+    pending.push_back(Visit{root, 1, (root->color == COLOR_BLACK) ? 1 : 0});
+    result.balanced = (root->color == COLOR_BLACK);
+    result.blackHeight = -2;   // not seen a leaf yet
+    size_t depthSum = 0;
+    while (!pending.empty()) {
+        Visit v = pending.back();
+        pending.pop_back();
+        depthSum += v.depth;
+        result.maxDepth = max(result.maxDepth, v.depth);
+        for (const Node *child : {v.node->left, v.node->right}) {
+            if (child == nullptr) {
+                if (result.blackHeight == -2) {
+                    result.blackHeight = v.blacks;
+                } else if (result.blackHeight != v.blacks) {
+                    result.blackHeight = -1;
+                }
+                continue;
+            }
+            if (v.node->color == COLOR_RED && child->color == COLOR_RED) {
+                result.balanced = false;
+            }
+            pending.push_back(Visit{child, v.depth + 1, v.blacks + (child->color == COLOR_BLACK)});
+        }
+    }
+    if (result.blackHeight == -1) result.balanced = false;
+    result.averageDepth = static_cast<double>(depthSum) / Size();
+    return result;
+}
+
+// ResetStats
+// Sets the counters back to zero. Does nothing without RBT_ENABLE_STATS.
+RBT_TEMPLATE
+void RBT_CLASS::ResetStats() {
+#ifdef RBT_ENABLE_STATS
+    for (atomic<unsigned long long> *counter : {&stats.searches, &stats.searchComparisons, &stats.insertDescents,
+            &stats.insertComparisons, &stats.insertRecolorCases, &stats.insertOuterRotations,
+            &stats.insertInnerRotations, &stats.removeCase1, &stats.removeCase2, &stats.removeCase3,
+            &stats.removeCase4, &stats.leftRotations, &stats.rightRotations, &stats.recolors}) {
+        counter->store(0, memory_order_relaxed);
+    }
+#endif
+}
+
+// Validate
+// Checks every structural invariant in one O(n) walk with an explicit
+// stack: keys strictly increasing in order, a black root, no red node with
+// a red child, the same black height on every path, parent links that
+// match the child links, numItems, the cached leftmost and rightmost
+// nodes, and the subtree sizes when OrderStatistics is on. Returns false
+// at the first violation and, if problem is given, describes it there.
+// A walk that finds more nodes than numItems stops, so a link cycle is
+// reported instead of hanging.
+RBT_TEMPLATE
+bool RBT_CLASS::Validate(string *problem) const {
+    auto fail = [problem](const char *what) {
+        if (problem != nullptr) *problem = what;
+        return false;
+    };
+    if (root == nullptr) {
+        if (numItems != 0) return fail("Empty tree with a nonzero item count.");
+        if (leftmost != nullptr || rightmost != nullptr) return fail("Empty tree with cached end nodes.");
+        return true;
+    }
+    if (root->parent != nullptr) return fail("Root has a parent.");
+    if (root->color != COLOR_BLACK) return fail("Root is red.");
+
+    // low and high are the nearest ancestors the node's key must lie between
+    struct Visit {
+        const Node *node;
+        const Node *low;
+        const Node *high;
+        int blacks;   // black nodes from the root down to node, itself included
+    };
+    vector<Visit> pending;
+    pending.push_back(Visit{root, nullptr, nullptr, 1});
+    int blackHeight = -1;
+    size_t count = 0;
+    while (!pending.empty()) {
+        Visit v = pending.back();
+        pending.pop_back();
+        const Node *n = v.node;
+        if (++count > numItems) return fail("More nodes than the item count, or a link cycle.");
+        if (v.low != nullptr && !comp(v.low->data, n->data)) return fail("Keys out of order.");
+        if (v.high != nullptr && !comp(n->data, v.high->data)) return fail("Keys out of order.");
+        if constexpr (OrderStatistics) {
+            if (n->subtreeSize != SubtreeSize(n->left) + SubtreeSize(n->right) + 1) {
+                return fail("Wrong subtree size.");
+            }
+        }
+        for (const Node *child : {n->left, n->right}) {
+            if (child == nullptr) {
+                if (blackHeight == -1) blackHeight = v.blacks;
+                if (blackHeight != v.blacks) return fail("Black heights differ.");
+                continue;
+            }
+            if (child->parent != n) return fail("Parent link does not match child link.");
+            if (n->color == COLOR_RED && child->color == COLOR_RED) return fail("Red node with a red child.");
+            bool isLeft = (child == n->left);
+            pending.push_back(Visit{child, isLeft ? v.low : n, isLeft ? n : v.high, v.blacks + (child->color == COLOR_BLACK)});
+        }
+    }
+    if (count != numItems) return fail("Fewer nodes than the item count.");
+    if (leftmost != InfixFirst(root)) return fail("Cached leftmost is not the first node.");
+    if (rightmost != InfixLast(root)) return fail("Cached rightmost is not the last node.");
+    return true;
+}
+
+// LowerBound
+// Returns an iterator to the first key not less than data, or end().
+RBT_TEMPLATE
+typename RBT_CLASS::const_iterator RBT_CLASS::LowerBound(const Key &data) const {
+    const Node *curr = root;
+    const Node *found = nullptr;
+    while (curr != nullptr) {
+        bool right = comp(curr->data, data);
+        found = SelectNode(right, found, curr);
+        curr = right ? curr->right : curr->left;
+    }
+    return const_iterator(found, this);
+}
+
+// UpperBound
+// Returns an iterator to the first key greater than data, or end().
+RBT_TEMPLATE
+typename RBT_CLASS::const_iterator RBT_CLASS::UpperBound(const Key &data) const {
+    const Node *curr = root;
+    const Node *found = nullptr;
+    while (curr != nullptr) {
+        bool left = comp(data, curr->data);
+        found = SelectNode(left, curr, found);
+        curr = left ? curr->left : curr->right;
+    }
+    return const_iterator(found, this);
+}
+
+// Range
+// Returns the iterator pair covering every key in [low, high).
+// The pair is empty if high <= low.
+RBT_TEMPLATE
+pair<typename RBT_CLASS::const_iterator, typename RBT_CLASS::const_iterator> RBT_CLASS::Range(const Key &low, const Key &high) const {
+    const_iterator first = LowerBound(low);
+    if (!comp(low, high)) return make_pair(first, first);
+    return make_pair(first, LowerBound(high));
+}
+
+// Rank
+// Returns how many keys in the tree are less than data.
+RBT_TEMPLATE
+template <bool Enabled, class>
+size_t RBT_CLASS::Rank(const Key &data) const {
+    size_t rank = 0;
+    const Node *curr = root;
+    while (curr != nullptr) {
+        if (comp(curr->data, data)) {
+            rank += SubtreeSize(curr->left) + 1;
+            curr = curr->right;
+        } else {
+            curr = curr->left;
+        }
+    }
+    return rank;
+}
+
+// Select
+// Returns the k-th smallest key, counting from 0.
+// Throws out_of_range if k is not less than Size().
+RBT_TEMPLATE
+template <bool Enabled, class>
+const Key &RBT_CLASS::Select(size_t k) const {
+    if (k >= numItems) throw out_of_range("Select index out of range.");
+    const Node *curr = root;
+    while (true) {
+        size_t leftSize = SubtreeSize(curr->left);
+        if (k < leftSize) {
+            curr = curr->left;
+        } else if (k == leftSize) {
+            return curr->data;
+        } else {
+            k -= leftSize + 1;
+            curr = curr->right;
+        }
+    }
+}
+
+// CountInRange
+// Returns how many keys fall in [low, high).
+RBT_TEMPLATE
+template <bool Enabled, class>
+size_t RBT_CLASS::CountInRange(const Key &low, const Key &high) const {
+    if (!comp(low, high)) return 0;
+    return Rank(high) - Rank(low);
+}
+
+// SubtreeSize / UpdateSubtreeSize
+// Read and recompute the order-statistic size of a node. Both are no-ops
+// when order statistics are disabled.
+RBT_TEMPLATE
+inline size_t RBT_CLASS::SubtreeSize(const Node *n) {
+    if constexpr (OrderStatistics) {
+        return (n == nullptr) ? 0 : n->subtreeSize;
+    } else {
+        return 0;
+    }
+}
+
+RBT_TEMPLATE
+inline void RBT_CLASS::UpdateSubtreeSize(Node *n) {
+    if constexpr (OrderStatistics) {
+        n->subtreeSize = 1 + SubtreeSize(n->left) + SubtreeSize(n->right);
+    }
+}
+
+// ForEach
+// Calls visit(key) for every key in the given order. Walks the parent
+// pointers, so it needs no recursion, no stack and no string formatting.
+RBT_TEMPLATE
+template <class Visitor>
+void RBT_CLASS::ForEach(Visitor visit, Traversal order) const {
+    ForEachNode([&visit](const Node *n) { visit(n->data); }, order);
+}
+
+// CopyKeys
+// Writes every key in the given order to an output iterator.
+RBT_TEMPLATE
+template <class OutputIt>
+OutputIt RBT_CLASS::CopyKeys(OutputIt out, Traversal order) const {
+    ForEachNode([&out](const Node *n) { *out++ = n->data; }, order);
+    return out;
+}
+
+// ForEachNode
+// Iterative traversal shared by ForEach, CopyKeys and the string writers.
+RBT_TEMPLATE
+template <class NodeVisitor>
+void RBT_CLASS::ForEachNode(NodeVisitor visit, Traversal order) const {
+    if (root == nullptr) return;
+    switch (order) {
+        case Traversal::Infix:
+            for (const Node *n = InfixFirst(root); n != nullptr; n = InfixNext(n)) visit(n);
+            break;
+        case Traversal::Prefix:
+            for (const Node *n = root; n != nullptr; n = PrefixNext(n)) visit(n);
+            break;
+        case Traversal::Postfix:
+            for (const Node *n = PostfixFirst(root); n != nullptr; n = PostfixNext(n)) visit(n);
+            break;
+    }
+}
+
+// InfixFirst / InfixNext
+// Leftmost node of a subtree, and the in-order successor of a node.
+RBT_TEMPLATE
+inline const typename RBT_CLASS::Node *RBT_CLASS::InfixFirst(const Node *n) {
+    while (n->left != nullptr) n = n->left;
+    return n;
+}
+
+RBT_TEMPLATE
+inline const typename RBT_CLASS::Node *RBT_CLASS::InfixNext(const Node *n) {
+    if (n->right != nullptr) return InfixFirst(n->right);
+    while (n->parent != nullptr && n == n->parent->right) n = n->parent;
+    return n->parent;
+}
+
+// InfixLast / InfixPrev
+// Rightmost node of a subtree, and the in-order predecessor of a node.
+RBT_TEMPLATE
+inline const typename RBT_CLASS::Node *RBT_CLASS::InfixLast(const Node *n) {
+    while (n->right != nullptr) n = n->right;
+    return n;
+}
+
+RBT_TEMPLATE
+inline const typename RBT_CLASS::Node *RBT_CLASS::InfixPrev(const Node *n) {
+    if (n->left != nullptr) return InfixLast(n->left);
+    while (n->parent != nullptr && n == n->parent->left) n = n->parent;
+    return n->parent;
+}
+
+// PrefixNext
+// Pre-order successor: a child if there is one, otherwise the right child of
+// the closest ancestor whose right subtree has not been visited yet.
+RBT_TEMPLATE
+inline const typename RBT_CLASS::Node *RBT_CLASS::PrefixNext(const Node *n) {
+    if (n->left != nullptr) return n->left;
+    if (n->right != nullptr) return n->right;
+    while (n->parent != nullptr) {
+        if (n == n->parent->left && n->parent->right != nullptr) return n->parent->right;
+        n = n->parent;
+    }
+    return nullptr;
+}
+
+// PostfixFirst / PostfixNext
+// First node visited in post-order within a subtree, and the post-order successor.
+RBT_TEMPLATE
+inline const typename RBT_CLASS::Node *RBT_CLASS::PostfixFirst(const Node *n) {
+    while (true) {
+        if (n->left != nullptr) n = n->left;
+        else if (n->right != nullptr) n = n->right;
+        else return n;
+    }
+}
+
+RBT_TEMPLATE
+inline const typename RBT_CLASS::Node *RBT_CLASS::PostfixNext(const Node *n) {
+    const Node *parent = n->parent;
+    if (parent == nullptr) return nullptr;
+    if (n == parent->left && parent->right != nullptr) return PostfixFirst(parent->right);
+    return parent;
+}
+
+// ToString
+// Returns the tree as a string in the given order, e.g. " B12  R5 " for each node.
+RBT_TEMPLATE
+string RBT_CLASS::ToString(Traversal order) const {
+    string out;
+    AppendString(out, order);
+    return out;
+}
+
+// AppendString
+// Appends the traversal to a caller-supplied string, reserving room up front
+// so a large tree is written without repeated reallocation.
+RBT_TEMPLATE
+void RBT_CLASS::AppendString(string &out, Traversal order) const {
+    out.reserve(out.size() + Size() * 8);
+    ForEachNode([&out](const Node *n) { AppendNodeString(n, out); }, order);
+}
+
+// WriteString
+// Streams the traversal to an ostream through a fixed-size buffer.
+RBT_TEMPLATE
+void RBT_CLASS::WriteString(ostream &os, Traversal order) const {
+    const size_t flushAt = 4096;
+    string buffer;
+    buffer.reserve(flushAt + 16);
+    ForEachNode([&](const Node *n) {
+        AppendNodeString(n, buffer);
+        if (buffer.size() >= flushAt) {
+            os.write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+    }, order);
+    os.write(buffer.data(), buffer.size());
+}
+
+// AppendNodeString
+// Appends one node as " <color><data> ": color is "R", "B", or "D" (dummy).
+// Integer keys are formatted with to_chars, anything else through operator<<.
+RBT_TEMPLATE
+void RBT_CLASS::AppendNodeString(const Node *n, string &out) {
+    out += ' ';
+    if (n->color == COLOR_RED) out += 'R';
+    else if (n->color == COLOR_BLACK) out += 'B';
+    else out += 'D';
+    if constexpr (is_integral<Key>::value) {
+        char digits[24];
+        char *end = to_chars(digits, digits + sizeof(digits), n->data).ptr;
+        out.append(digits, end);
+    } else {
+        ostringstream os;
+        os << n->data;
+        out += os.str();
+    }
+    out += ' ';
+}
@@ -1,7 +1,32 @@
+#include <unistd.h>
 #include <iostream>
 #include <cassert>
 #include <random>
+#include <sstream>
+#include <algorithm>
+#include <cstdio>
+#include <atomic>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <set>
+#include <string>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 #include "RedBlackTree.h"
+#include "CompactRedBlackTree.h"
+#include "BPlusTree.h"
+#include "BucketedRedBlackTree.h"
+#include "ConcurrentRedBlackTree.h"
+#include "PersistentRedBlackTree.h"
+#include "MappedRedBlackTree.h"
+#include "PageArena.h"
+#include "FrozenRedBlackTree.h"
+#include "IncrementalRebuild.h"
+#include "IntStream.h"
+#include "ShardedRedBlackTree.h"
 
 using namespace std;
 
@@ -119,6 +144,52 @@ void TestToStrings() {
     cout << "PASSED!" << endl << endl;
 }
 
+void TestTraversals() {
+    cout << "Testing Iterative Traversals..." << endl;
+    RedBlackTree rbt;
+    rbt.Insert(12);
+    rbt.Insert(11);
+    rbt.Insert(15);
+    rbt.Insert(5);
+    rbt.Insert(13);
+    rbt.Insert(7);
+
+    vector<int> keys;
+    rbt.ForEach([&keys](int key) { keys.push_back(key); });
+    assert((keys == vector<int>{5, 7, 11, 12, 13, 15}));
+
+    keys.clear();
+    rbt.ForEach([&keys](int key) { keys.push_back(key); }, Traversal::Prefix);
+    assert((keys == vector<int>{12, 7, 5, 11, 15, 13}));
+
+    keys.clear();
+    rbt.CopyKeys(back_inserter(keys), Traversal::Postfix);
+    assert((keys == vector<int>{5, 11, 7, 13, 15, 12}));
+
+    string out = "tree:";
+    rbt.AppendString(out, Traversal::Infix);
+    assert(out == "tree: R5  B7  R11  B12  R13  B15 ");
+
+    ostringstream os;
+    rbt.WriteString(os, Traversal::Prefix);
+    assert(os.str() == rbt.ToPrefixString());
+
+    // Sorted inserts, large enough that the streamed output needs several flushes
+    RedBlackTree sorted;
+    for (int i = -2000; i < 2000; i++) {
+        sorted.Insert(i);
+    }
+    keys.clear();
+    sorted.CopyKeys(back_inserter(keys));
+    assert(keys.size() == 4000);
+    assert(is_sorted(keys.begin(), keys.end()));
+    ostringstream big;
+    sorted.WriteString(big, Traversal::Postfix);
+    assert(big.str() == sorted.ToPostfixString());
+
+    cout << "PASSED!" << endl << endl;
+}
+
 void TestInsertRandomTests(){
 	cout << "Testing Random Insert Stuff..." << endl;
 	cout << "\t This test passes if it doesn't crash and valgrind reports no issues" << endl;
@@ -184,6 +255,63 @@ void TestCopyConstructor() {
     cout << "PASSED!" << endl << endl;
 }
 
+void TestMoveAndAssignment() {
+    cout << "Testing Move, Assignment and Swap..." << endl;
+    RedBlackTree rbt1;
+    for (int key : {11, 23, 9, 52, 31, 4}) {
+        rbt1.Insert(key);
+    }
+    string expected = rbt1.ToPrefixString();
+
+    RedBlackTree moved(move(rbt1));
+    assert(moved.ToPrefixString() == expected);
+    assert(rbt1.Size() == 0);
+    rbt1.Insert(7);
+    assert(rbt1.ToPrefixString() == " B7 ");
+
+    RedBlackTree copy;
+    copy.Insert(100);
+    copy = moved;
+    assert(copy.ToPrefixString() == expected);
+    copy.Insert(200);
+    assert(moved.ToPrefixString() == expected);
+    copy = copy;
+    assert(copy.Size() == 7);
+
+    RedBlackTree target;
+    target.Insert(1);
+    target = move(copy);
+    assert(target.Size() == 7 && target.Contains(200) && !target.Contains(1));
+    assert(copy.Size() == 0);
+
+    swap(target, rbt1);
+    assert(target.ToPrefixString() == " B7 ");
+    assert(rbt1.Size() == 7);
+    rbt1.Swap(target);
+    assert(rbt1.ToPrefixString() == " B7 ");
+
+    vector<RedBlackTree> trees;
+    for (int i = 0; i < 20; i++) {
+        RedBlackTree t;
+        for (int j = 0; j <= i; j++) {
+            t.Insert(j);
+        }
+        trees.push_back(move(t));
+    }
+    for (int i = 0; i < 20; i++) {
+        assert(trees[i].Size() == size_t(i + 1));
+        assert(trees[i].GetMax() == i);
+    }
+
+    RedBlackTreeMap<int, unique_ptr<int>> owners;
+    owners.Emplace(1, new int(10));
+    RedBlackTreeMap<int, unique_ptr<int>> newOwners;
+    newOwners = move(owners);
+    assert(*newOwners.At(1) == 10);
+
+    cout << "PASSED!" << endl << endl;
+}
+
 void TestContains() {
     cout << "Testing Contains..." << endl;
     RedBlackTree* rbt = new RedBlackTree();
@@ -209,6 +337,129 @@ void TestContains() {
     cout << "PASSED!" << endl << endl;
 }
 
+void TestContainsMany() {
+    cout << "Testing ContainsMany and FindMany..." << endl;
+    RedBlackTree empty;
+    vector<int> none = {1, 2, 3};
+    vector<bool> found;
+    empty.ContainsMany(none, found);
+    assert((found == vector<bool>{false, false, false}));
+
+    RedBlackTree rbt;
+    for (int i = 0; i < 1000; i++) {
+        rbt.Insert(i * 3);
+    }
+    vector<int> queries;
+    for (int i = -10; i < 3010; i += 7) {
+        queries.push_back(i);
+    }
+    rbt.ContainsMany(queries, found);
+    assert(found.size() == queries.size());
+    for (size_t i = 0; i < queries.size(); i++) {
+        assert(found[i] == rbt.Contains(queries[i]));
+    }
+
+    vector<RedBlackTree::const_iterator> iterators(queries.size());
+    rbt.FindMany(queries.data(), queries.size(), iterators.data());
+    for (size_t i = 0; i < queries.size(); i++) {
+        assert(iterators[i] == rbt.Find(queries[i]));
+    }
+
+    cout << "PASSED!" << endl << endl;
+}
+
+void TestInsertMany() {
+    cout << "Testing InsertMany..." << endl;
+    RedBlackTree rbt;
+    vector<int> duplicates;
+    vector<int> first = {9, 3, 5, 3, 1};
+    assert(rbt.InsertMany(first.begin(), first.end(), &duplicates) == 4);
+    assert((duplicates == vector<int>{3}));
+    assert(rbt.ToInfixString() == " R1  B3  B5  B9 ");
+
+    // Sorted runs landing between and around existing keys
+    set<int> expected(first.begin(), first.end());
+    mt19937 gen(12);
+    for (int batch = 0; batch < 50; batch++) {
+        int start = uniform_int_distribution<int>(0, 20000)(gen);
+        vector<int> keys;
+        for (int i = 0; i < 200; i++) {
+            keys.push_back(start + i * 3);
+        }
+        if (batch % 5 == 0) {
+            shuffle(keys.begin(), keys.end(), gen);
+        }
+        size_t before = expected.size();
+        duplicates.clear();
+        size_t inserted = rbt.InsertMany(keys.begin(), keys.end(), &duplicates);
+        expected.insert(keys.begin(), keys.end());
+        assert(inserted == expected.size() - before);
+        assert(inserted + duplicates.size() == keys.size());
+        for (int key : duplicates) {
+            assert(rbt.Contains(key));
+        }
+    }
+    assert(rbt.Size() == expected.size());
+    assert(equal(rbt.begin(), rbt.end(), expected.begin(), expected.end()));
+
+    RankedRedBlackTree ranked;
+    ranked.Insert(50);
+    vector<int> run = {10, 20, 30, 40, 60, 70};
+    assert(ranked.InsertMany(run.begin(), run.end()) == 6);
+    for (size_t k = 0; k < ranked.Size(); k++) {
+        assert(ranked.Rank(ranked.Select(k)) == k);
+    }
+    assert(ranked.CountInRange(20, 61) == 5);
+
+    cout << "PASSED!" << endl << endl;
+}
+
+void TestHintedInsert() {
+    cout << "Testing hinted Insert..." << endl;
+    RedBlackTree rbt;
+    for (int i = 0; i < 1000; i++) {
+        RedBlackTree::const_iterator it = rbt.Insert(rbt.end(), i);
+        assert(*it == i);
+    }
+    RedBlackTree::const_iterator hint = rbt.begin();
+    for (int i = -1; i >= -1000; i--) {
+        hint = rbt.Insert(hint, i);
+    }
+    assert(rbt.Size() == 2000);
+    assert(rbt.GetMin() == -1000 && rbt.GetMax() == 999);
+
+    // Wrong or far away hints still insert in the right place
+    set<int> expected(rbt.begin(), rbt.end());
+    mt19937 gen(13);
+    uniform_int_distribution<int> dist(-5000, 5000);
+    for (int i = 0; i < 3000; i++) {
+        int key = dist(gen);
+        RedBlackTree::const_iterator near = rbt.Find(dist(gen));
+        pair<RedBlackTree::const_iterator, bool> result = rbt.TryInsert(near, key);
+        assert(*result.first == key);
+        assert(result.second == expected.insert(key).second);
+    }
+    assert(equal(rbt.begin(), rbt.end(), expected.begin(), expected.end()));
+
+    bool threw = false;
+    try {
+        rbt.Insert(rbt.Find(5), 5);
+    } catch (const invalid_argument &) {
+        threw = true;
+    }
+    assert(threw);
+
+    RankedRedBlackTree ranked;
+    RankedRedBlackTree::const_iterator last = ranked.end();
+    for (int i = 0; i < 100; i++) {
+        last = ranked.Insert(ranked.end(), i * 2);
+    }
+    ranked.Insert(last, 197);
+    assert(ranked.Rank(197) == 99 && ranked.Select(100) == 198);
+
+    cout << "PASSED!" << endl << endl;
+}
+
 void TestGetMinimumMaximum() {
     cout << "Testing Get Minimum and Get Maximum..." << endl;
     RedBlackTree* rbt = new RedBlackTree();
@@ -227,6 +478,1722 @@ void TestGetMinimumMaximum() {
     cout << "PASSED!" << endl << endl;
 }
 
+void TestCachedMinMax() {
+    cout << "Testing Cached Minimum and Maximum..." << endl;
+    auto ends = [](const RedBlackTree &rbt, const set<int> &expected) {
+        assert(rbt.Size() == expected.size());
+        if (expected.empty()) {
+            assert(rbt.begin() == rbt.end());
+            return;
+        }
+        assert(rbt.GetMin() == *expected.begin());
+        assert(rbt.GetMax() == *expected.rbegin());
+        assert(*rbt.begin() == *expected.begin());
+        assert(*(--rbt.end()) == *expected.rbegin());
+    };
+
+    // Ends move with inserts, removes, erases and pops at either end
+    mt19937 gen(27);
+    uniform_int_distribution<int> dist(0, 500);
+    RedBlackTree rbt;
+    set<int> expected;
+    for (int i = 0; i < 4000; i++) {
+        int key = dist(gen);
+        switch (i % 5) {
+            case 0:
+            case 1:
+                assert(rbt.TryInsert(key) == expected.insert(key).second);
+                break;
+            case 2:
+                assert(rbt.Remove(key) == (expected.erase(key) == 1));
+                break;
+            case 3:
+                if (!expected.empty()) {
+                    assert(rbt.PopMin() == *expected.begin());
+                    expected.erase(expected.begin());
+                }
+                break;
+            default:
+                if (!expected.empty()) {
+                    int max = *expected.rbegin();
+                    assert(rbt.Erase(rbt.Find(max)) == rbt.end());
+                    expected.erase(max);
+                }
+                break;
+        }
+        ends(rbt, expected);
+    }
+    while (!expected.empty()) {
+        assert(rbt.PopMax() == *expected.rbegin());
+        expected.erase(prev(expected.end()));
+        ends(rbt, expected);
+    }
+    ends(rbt, expected);
+
+    // Hinted inserts at both ends
+    for (int i = 0; i < 100; i++) {
+        rbt.Insert(rbt.begin(), -i);
+        rbt.Insert(rbt.end(), 1000 + i);
+        expected.insert(-i);
+        expected.insert(1000 + i);
+        ends(rbt, expected);
+    }
+
+    // Wholesale replacements of the root
+    RedBlackTree copy(rbt);
+    ends(copy, expected);
+    RedBlackTree moved(move(copy));
+    ends(moved, expected);
+    ends(copy, set<int>());
+    RedBlackTree other;
+    other.Insert(5000);
+    other.Swap(moved);
+    ends(other, expected);
+    assert(moved.GetMin() == 5000 && moved.GetMax() == 5000);
+    moved = other;
+    ends(moved, expected);
+
+    RedBlackTree greater = moved.Split(500);
+    set<int> low(expected.begin(), expected.lower_bound(500));
+    set<int> high(expected.lower_bound(500), expected.end());
+    ends(moved, low);
+    ends(greater, high);
+    moved.Join(move(greater));
+    ends(moved, expected);
+    ends(greater, set<int>());
+
+    RedBlackTree extra;
+    extra.Insert(-1000);
+    extra.Insert(2000);
+    moved.Union(move(extra));
+    expected.insert(-1000);
+    expected.insert(2000);
+    ends(moved, expected);
+
+    vector<int> keys = {3, 1, 4, 1, 5, 9, 2, 6};
+    RedBlackTree built(keys.begin(), keys.end());
+    ends(built, set<int>(keys.begin(), keys.end()));
+    built.Clear();
+    ends(built, set<int>());
+    built.Insert(7);
+    ends(built, set<int>{7});
+
+    cout << "PASSED!" << endl << endl;
+}
+
+void TestTryInsert() {
+    cout << "Testing TryInsert..." << endl;
+    RedBlackTree rbt;
+    assert(rbt.TryInsert(30));
+    assert(rbt.TryInsert(15));
+    assert(!rbt.TryInsert(30));
+    assert(!rbt.TryInsert(15));
+    assert(rbt.TryInsert(10));
+    assert(rbt.Size() == 3);
+    assert(rbt.ToPrefixString() == " B15  R10  R30 ");
+
+    bool threw = false;
+    try {
+        rbt.Insert(10);
+    } catch (invalid_argument &e) {
+        threw = true;
+    }
+    assert(threw);
+    assert(rbt.Size() == 3);
+
+    cout << "PASSED!" << endl << endl;
+}
+
+void TestIteratorsAndRanges() {
+    cout << "Testing Iterators and Range Queries..." << endl;
+    RedBlackTree empty;
+    assert(empty.begin() == empty.end());
+    assert(empty.LowerBound(3) == empty.end());
+
+    RedBlackTree rbt;
+    for (int key : {40, 22, 15, 31, 55, 12, 17, 29, 34}) {
+        rbt.Insert(key);
+    }
+
+    vector<int> keys(rbt.begin(), rbt.end());
+    assert((keys == vector<int>{12, 15, 17, 22, 29, 31, 34, 40, 55}));
+
+    vector<int> reversed;
+    RedBlackTree::const_iterator it = rbt.end();
+    while (it != rbt.begin()) {
+        --it;
+        reversed.push_back(*it);
+    }
+    assert((reversed == vector<int>(keys.rbegin(), keys.rend())));
+
+    assert(*rbt.Find(29) == 29);
+    assert(rbt.Find(30) == rbt.end());
+
+    assert(*rbt.LowerBound(22) == 22);
+    assert(*rbt.LowerBound(23) == 29);
+    assert(*rbt.UpperBound(22) == 29);
+    assert(*rbt.LowerBound(-100) == 12);
+    assert(rbt.LowerBound(56) == rbt.end());
+    assert(rbt.UpperBound(55) == rbt.end());
+
+    auto range = rbt.Range(16, 34);
+    vector<int> inRange(range.first, range.second);
+    assert((inRange == vector<int>{17, 22, 29, 31}));
+
+    range = rbt.Range(34, 16);
+    assert(range.first == range.second);
+
+    range = rbt.Range(0, 1000);
+    assert(distance(range.first, range.second) == 9);
+
+    cout << "PASSED!" << endl << endl;
+}
+
+void TestOrderStatistics() {
+    cout << "Testing Order Statistics..." << endl;
+    assert(sizeof(RBTNode) == sizeof(BasicRBTNode<int, NoValue, true>) - sizeof(size_t));
+
+    RankedRedBlackTree rbt;
+    vector<int> keys;
+    mt19937 gen(11);
+    uniform_int_distribution<int> dist(-100000, 100000);
+    for (int i = 0; i < 5000; i++) {
+        int value = dist(gen);
+        if (rbt.TryInsert(value)) {
+            keys.push_back(value);
+        }
+    }
+    sort(keys.begin(), keys.end());
+    assert(rbt.Size() == keys.size());
+
+    for (size_t k = 0; k < keys.size(); k += 37) {
+        assert(rbt.Select(k) == keys[k]);
+        assert(rbt.Rank(keys[k]) == k);
+        assert(rbt.Rank(keys[k] + 1) == k + 1);
+    }
+    assert(rbt.Rank(-200000) == 0);
+    assert(rbt.Rank(200000) == keys.size());
+
+    size_t expected = lower_bound(keys.begin(), keys.end(), 5000) - lower_bound(keys.begin(), keys.end(), -5000);
+    assert(rbt.CountInRange(-5000, 5000) == expected);
+    assert(rbt.CountInRange(5000, -5000) == 0);
+
+    bool threw = false;
+    try {
+        rbt.Select(keys.size());
+    } catch (out_of_range &e) {
+        threw = true;
+    }
+    assert(threw);
+
+    // Sizes must also be right after a bulk build and a copy
+    RankedRedBlackTree built(keys.begin(), keys.end());
+    RankedRedBlackTree copy(built);
+    copy.Insert(300000);
+    assert(built.Select(keys.size() / 2) == keys[keys.size() / 2]);
+    assert(copy.Select(keys.size()) == 300000);
+    assert(copy.Rank(keys.back()) == keys.size() - 1);
+
+    cout << "PASSED!" << endl << endl;
+}
+
+void TestGenericKeysAndValues() {
+    cout << "Testing Generic Keys and Values..." << endl;
+    RedBlackTreeMap<string, int> words;
+    assert(words.Emplace("pear", 3).second);
+    assert(words.Emplace("apple", 1).second);
+    assert(words.Emplace("fig", 2).second);
+    auto result = words.Emplace("apple", 100);
+    assert(!result.second);
+    assert(result.first.key() == "apple" && result.first.value() == 1);
+    assert(words.ToInfixString() == " Rapple  Bfig  Rpear ");
+
+    words.At("fig") = 20;
+    assert(words.At("fig") == 20);
+    assert(*words.GetValue("pear") == 3);
+    assert(words.GetValue("kiwi") == nullptr);
+    bool threw = false;
+    try {
+        words.At("kiwi");
+    } catch (out_of_range &e) {
+        threw = true;
+    }
+    assert(threw);
+
+    RedBlackTreeMap<string, int> copy(words);
+    copy.At("pear") = 30;
+    assert(words.At("pear") == 3);
+    assert(copy.GetMin() == "apple" && copy.GetMax() == "pear");
+
+    // Move-only values are constructed in place and destroyed with the tree
+    RedBlackTreeMap<int, unique_ptr<int>> owners;
+    for (int i = 0; i < 100; i++) {
+        owners.Emplace(i, new int(i * i));
+    }
+    assert(!owners.Emplace(5, nullptr).second);
+    assert(*owners.At(9) == 81);
+
+    // Custom ordering
+    BasicRedBlackTree<int, NoValue, greater<int>> descending;
+    for (int key : {5, 1, 9, 3}) {
+        descending.Insert(key);
+    }
+    vector<int> keys(descending.begin(), descending.end());
+    assert((keys == vector<int>{9, 5, 3, 1}));
+    assert(descending.GetMin() == 9);
+    assert(*descending.LowerBound(4) == 3);
+
+    cout << "PASSED!" << endl << endl;
+}
+
+void TestRemove() {
+    cout << "Testing Remove..." << endl;
+    RedBlackTree rbt;
+    for (int key : {30, 15, 45, 10, 25}) {
+        rbt.Insert(key);
+    }
+    assert(rbt.ToPrefixString() == " B30  B15  R10  R25  B45 ");
+    assert(rbt.Remove(45));
+    assert(rbt.ToPrefixString() == " B15  B10  B30  R25 ");
+    assert(!rbt.Remove(45));
+    assert(rbt.Remove(15));
+    assert(rbt.ToPrefixString() == " B25  B10  B30 ");
+    assert(rbt.PopMin() == 10);
+    assert(rbt.PopMax() == 30);
+    assert(rbt.ToPrefixString() == " B25 ");
+    assert(rbt.PopMin() == 25);
+    assert(rbt.Size() == 0);
+    assert(rbt.ToPrefixString() == "");
+
+    bool threw = false;
+    try {
+        rbt.PopMax();
+    } catch (underflow_error &e) {
+        threw = true;
+    }
+    assert(threw);
+
+    // Randomized churn checked against std::set and the order statistics
+    RankedRedBlackTree ranked;
+    set<int> expected;
+    mt19937 gen(3);
+    uniform_int_distribution<int> dist(0, 2000);
+    for (int i = 0; i < 20000; i++) {
+        int value = dist(gen);
+        if (gen() % 2 == 0) {
+            assert(ranked.TryInsert(value) == expected.insert(value).second);
+        } else {
+            assert(ranked.Remove(value) == (expected.erase(value) == 1));
+        }
+    }
+    assert(ranked.Size() == expected.size());
+    assert((vector<int>(ranked.begin(), ranked.end()) == vector<int>(expected.begin(), expected.end())));
+    size_t k = 0;
+    for (int key : expected) {
+        assert(ranked.Select(k) == key);
+        assert(ranked.Rank(key) == k);
+        k++;
+    }
+
+    // Erase returns the next key, so a range can be erased in one pass
+    auto range = ranked.Range(500, 1500);
+    for (auto it = range.first; it != range.second; ) {
+        it = ranked.Erase(it);
+    }
+    assert(ranked.CountInRange(500, 1500) == 0);
+    assert(ranked.Size() == expected.size() - distance(expected.lower_bound(500), expected.lower_bound(1500)));
+
+    // Removed nodes are recycled, so steady churn does not grow the pool
+    RedBlackTree churn;
+    for (int i = 0; i < 1000; i++) {
+        churn.Insert(i);
+    }
+    size_t capacity = churn.Capacity();
+    for (int i = 0; i < 10000; i++) {
+        churn.Remove(i);
+        churn.Insert(i + 1000);
+    }
+    assert(churn.Size() == 1000);
+    assert(churn.Capacity() == capacity);
+    assert(churn.GetMin() == 10000);
+
+    // Reserving a new block keeps the unused end of the old one for later nodes
+    RedBlackTree reserved;
+    for (int i = 0; i < 100; i++) {
+        reserved.Insert(i);
+    }
+    vector<int> batch;
+    for (int i = 100; i < 300; i++) {
+        batch.push_back(i);
+    }
+    reserved.InsertMany(batch.begin(), batch.end());
+    capacity = reserved.Capacity();
+    for (int i = 300; reserved.Size() < capacity; i++) {
+        reserved.Insert(i);
+    }
+    assert(reserved.Capacity() == capacity);
+
+    cout << "PASSED!" << endl << endl;
+}
+
+void TestJoinSplitAndSetOperations() {
+    cout << "Testing Join, Split, Union, Intersection and Difference..." << endl;
+    RedBlackTree low, high;
+    for (int i = 0; i < 100; i++) {
+        low.Insert(i);
+        high.Insert(i + 100);
+    }
+    low.Join(move(high));
+    assert(low.Size() == 200 && high.Size() == 0);
+    assert(low.GetMin() == 0 && low.GetMax() == 199);
+
+    RedBlackTree overlap;
+    overlap.Insert(50);
+    bool threw = false;
+    try {
+        low.Join(move(overlap));
+    } catch (const invalid_argument &) {
+        threw = true;
+    }
+    assert(threw && overlap.Size() == 1);
+
+    RedBlackTree rest = low.Split(150);
+    assert(low.Size() == 150 && low.GetMax() == 149);
+    assert(rest.Size() == 50 && rest.GetMin() == 150 && rest.GetMax() == 199);
+    RedBlackTree all = low.Split(-1);
+    assert(low.Size() == 0 && all.Size() == 150);
+
+    // No node is copied: iterators into both halves stay valid, and each half
+    // works on its own after the other is gone
+    {
+        RedBlackTree whole;
+        for (int i = 0; i < 5000; i++) {
+            whole.Insert(i * 7 % 5000);
+        }
+        RedBlackTree::const_iterator below = whole.Find(10), above = whole.Find(4000);
+        RedBlackTree upper = whole.Split(2500);
+        assert(below == whole.Find(10) && *below == 10);
+        assert(above == upper.Find(4000) && *above == 4000);
+        upper.Insert(7000);
+        upper.Remove(4000);
+        whole.Remove(10);
+        assert(upper.Size() == 2500 && whole.Size() == 2499);
+        assert(whole.Validate() && upper.Validate());
+        assert(whole.GetMax() == 2499 && upper.GetMin() == 2500);
+        whole.Join(move(upper));
+        assert(whole.Size() == 4999 && whole.Validate());
+
+        RedBlackTree tail = whole.Split(4000);
+        whole = RedBlackTree();
+        for (int i = 8000; i < 9000; i++) {
+            tail.Insert(i);
+        }
+        assert(tail.Size() == 2000 && tail.Validate() && tail.Contains(4001));
+
+        RankedRedBlackTree ranks;
+        for (int i = 0; i < 1000; i++) {
+            ranks.Insert(i);
+        }
+        RankedRedBlackTree upperRanks = ranks.Split(600);
+        assert(ranks.Size() == 600 && upperRanks.Size() == 400);
+        assert(upperRanks.Select(0) == 600 && upperRanks.Validate());
+    }
+
+    mt19937 gen(14);
+    uniform_int_distribution<int> dist(0, 3000);
+    for (int round = 0; round < 20; round++) {
+        set<int> a, b;
+        for (int i = 0; i < 1000; i++) {
+            a.insert(dist(gen));
+            b.insert(dist(gen));
+        }
+        vector<int> unionKeys, intersectionKeys, differenceKeys;
+        set_union(a.begin(), a.end(), b.begin(), b.end(), back_inserter(unionKeys));
+        set_intersection(a.begin(), a.end(), b.begin(), b.end(), back_inserter(intersectionKeys));
+        set_difference(a.begin(), a.end(), b.begin(), b.end(), back_inserter(differenceKeys));
+
+        RedBlackTree u(a.begin(), a.end()), i(a.begin(), a.end()), d(a.begin(), a.end());
+        u.Union(RedBlackTree(b.begin(), b.end()));
+        i.Intersection(RedBlackTree(b.begin(), b.end()));
+        d.Difference(RedBlackTree(b.begin(), b.end()));
+        assert(u.Size() == unionKeys.size() && equal(u.begin(), u.end(), unionKeys.begin()));
+        assert(i.Size() == intersectionKeys.size() && equal(i.begin(), i.end(), intersectionKeys.begin()));
+        assert(d.Size() == differenceKeys.size() && equal(d.begin(), d.end(), differenceKeys.begin()));
+    }
+
+    // Subtree sizes stay right and the first tree's values win on shared keys
+    RankedRedBlackTree ranked;
+    for (int k = 0; k < 300; k += 3) {
+        ranked.Insert(k);
+    }
+    RankedRedBlackTree other;
+    for (int k = 0; k < 300; k += 2) {
+        other.Insert(k);
+    }
+    ranked.Union(move(other));
+    for (size_t k = 0; k < ranked.Size(); k++) {
+        assert(ranked.Rank(ranked.Select(k)) == k);
+    }
+    assert(ranked.CountInRange(0, 300) == 200);
+
+    RedBlackTreeMap<int, string> first, second;
+    first.Emplace(1, "first");
+    second.Emplace(1, "second");
+    second.Emplace(2, "second");
+    first.Union(move(second));
+    assert(first.At(1) == "first" && first.At(2) == "second");
+
+    cout << "PASSED!" << endl << endl;
+}
+
+void TestParallelOperations() {
+    cout << "Testing parallel set operations and bulk build..." << endl;
+    TaskPool tasks(4);
+    assert(tasks.ThreadCount() == 4);
+
+    mt19937 gen(15);
+    uniform_int_distribution<int> dist(0, 200000);
+    vector<int> aKeys, bKeys;
+    for (int i = 0; i < 50000; i++) {
+        aKeys.push_back(dist(gen));
+        bKeys.push_back(dist(gen));
+    }
+    RedBlackTree a(aKeys.begin(), aKeys.end(), tasks, 64);
+    RedBlackTree b(bKeys.begin(), bKeys.end(), tasks, 64);
+    assert(equal(a.begin(), a.end(), RedBlackTree(aKeys.begin(), aKeys.end()).begin()));
+
+    RedBlackTree u(a), i(a), d(a), expected(a);
+    u.Union(RedBlackTree(b), tasks, 64);
+    i.Intersection(RedBlackTree(b), tasks, 64);
+    d.Difference(RedBlackTree(b), tasks, 64);
+
+    expected.Union(RedBlackTree(b));
+    assert(u.Size() == expected.Size() && equal(u.begin(), u.end(), expected.begin()));
+    expected = a;
+    expected.Intersection(RedBlackTree(b));
+    assert(i.Size() == expected.Size() && equal(i.begin(), i.end(), expected.begin()));
+    expected = a;
+    expected.Difference(RedBlackTree(b));
+    assert(d.Size() == expected.Size() && equal(d.begin(), d.end(), expected.begin()));
+
+    RankedRedBlackTree ranked(aKeys.begin(), aKeys.end(), tasks, 64);
+    ranked.Union(RankedRedBlackTree(bKeys.begin(), bKeys.end()), tasks, 64);
+    assert(ranked.Size() == u.Size());
+    for (size_t k = 0; k < ranked.Size(); k += 97) {
+        assert(ranked.Rank(ranked.Select(k)) == k);
+    }
+
+    // Nested forks from a thread that is not a worker, and a pool with no workers
+    TaskPool inline_tasks(1);
+    atomic<int> left(0), right(0);
+    tasks.Invoke([&] { tasks.Invoke([&] { left++; }, [&] { left++; }); },
+                 [&] { inline_tasks.Invoke([&] { right++; }, [&] { right++; }); });
+    assert(left == 2 && right == 2);
+
+    bool threw = false;
+    try {
+        tasks.Invoke([] {}, [] { throw runtime_error("task failed"); });
+    } catch (const runtime_error &) {
+        threw = true;
+    }
+    assert(threw);
+
+    cout << "PASSED!" << endl << endl;
+}
+
+void TestConcurrentTree() {
+    cout << "Testing ConcurrentRedBlackTree..." << endl;
+    ConcurrentRedBlackTree<int> tree;
+    set<int> expected;
+    mt19937 gen(16);
+    uniform_int_distribution<int> dist(0, 2000);
+    for (int i = 0; i < 20000; i++) {
+        int key = dist(gen);
+        if (gen() % 2) {
+            assert(tree.TryInsert(key) == expected.insert(key).second);
+        } else {
+            assert(tree.Remove(key) == (expected.erase(key) == 1));
+        }
+    }
+    assert(tree.Size() == expected.size());
+    assert(tree.GetMin() == *expected.begin() && tree.GetMax() == *expected.rbegin());
+    vector<int> keys;
+    tree.ForEach([&](int key) { keys.push_back(key); });
+    assert(equal(keys.begin(), keys.end(), expected.begin(), expected.end()));
+
+    ConcurrentRedBlackTree<int, string> names;
+    names.Insert(1, "one");
+    string name;
+    assert(names.TryGet(1, name) && name == "one");
+    assert(!names.TryGet(2, name));
+
+    // Readers only ever see whole versions: the writer adds keys in pairs
+    // from the middle out, so every version is a contiguous run of keys.
+    ConcurrentRedBlackTree<int> shared;
+    atomic<bool> done(false);
+    atomic<int> broken(0);
+    vector<thread> readers;
+    for (int r = 0; r < 3; r++) {
+        readers.emplace_back([&]() {
+            while (!done.load()) {
+                vector<int> seen;
+                shared.ForEach([&](int key) { seen.push_back(key); });
+                for (size_t i = 1; i < seen.size(); i++) {
+                    if (seen[i] != seen[i - 1] + 1) broken++;
+                }
+                shared.Contains(0);
+            }
+        });
+    }
+    for (int i = 0; i < 2000; i++) {
+        shared.Insert(i);
+        shared.Insert(-i - 1);
+    }
+    for (int i = 1999; i >= 0; i--) {
+        shared.Remove(i);
+        shared.Remove(-i - 1);
+    }
+    done = true;
+    for (thread &reader : readers) {
+        reader.join();
+    }
+    assert(broken == 0 && shared.Size() == 0);
+
+    cout << "PASSED!" << endl << endl;
+}
+
+void TestPersistentTree() {
+    cout << "Testing PersistentRedBlackTree..." << endl;
+    // Every snapshot keeps the contents it was taken with while the tree
+    // keeps changing
+    PersistentRedBlackTree<int> tree;
+    set<int> expected;
+    vector<PersistentRedBlackTree<int>> snapshots;
+    vector<set<int>> snapshotContents;
+    mt19937 gen(17);
+    uniform_int_distribution<int> dist(0, 2000);
+    for (int i = 0; i < 20000; i++) {
+        int key = dist(gen);
+        if (gen() % 2) {
+            assert(tree.TryInsert(key) == expected.insert(key).second);
+        } else {
+            assert(tree.Remove(key) == (expected.erase(key) == 1));
+        }
+        if (i % 1000 == 0) {
+            snapshots.push_back(tree.Snapshot());
+            snapshotContents.push_back(expected);
+        }
+    }
+    assert(tree.Size() == expected.size());
+    assert(tree.GetMin() == *expected.begin() && tree.GetMax() == *expected.rbegin());
+    for (size_t i = 0; i < snapshots.size(); i++) {
+        vector<int> keys;
+        snapshots[i].ForEach([&](int key) { keys.push_back(key); });
+        assert(snapshots[i].Size() == snapshotContents[i].size());
+        assert(equal(keys.begin(), keys.end(), snapshotContents[i].begin(), snapshotContents[i].end()));
+    }
+
+    // Writing to a copy leaves the original alone, and the other way round
+    PersistentRedBlackTree<int, string> names;
+    names.Insert(1, "one");
+    names.Insert(2, "two");
+    PersistentRedBlackTree<int, string> copy = names;
+    copy.Remove(1);
+    copy.Insert(3, "three");
+    names.Insert(0, "zero");
+    assert(names.Size() == 3 && *names.GetValue(1) == "one" && names.GetValue(3) == nullptr);
+    assert(copy.Size() == 2 && copy.GetValue(1) == nullptr && *copy.GetValue(3) == "three");
+    copy = names;
+    assert(copy.Size() == 3 && copy.Contains(0));
+    names.Clear();
+    assert(names.Empty() && copy.Size() == 3);
+
+    bool threw = false;
+    try {
+        copy.Insert(2, "again");
+    } catch (const invalid_argument &e) {
+        threw = true;
+    }
+    assert(threw);
+
+    // A reader thread works through its own snapshot while the tree it came
+    // from keeps being written
+    PersistentRedBlackTree<int> source;
+    for (int i = 0; i < 1000; i++) {
+        source.Insert(i);
+    }
+    atomic<int> broken(0);
+    thread reader([&broken](PersistentRedBlackTree<int> snapshot) {
+        for (int round = 0; round < 50; round++) {
+            int next = 0;
+            snapshot.ForEach([&](int key) {
+                if (key != next++) broken++;
+            });
+            if (next != 1000) broken++;
+        }
+    }, source.Snapshot());
+    for (int i = 0; i < 1000; i++) {
+        source.Remove(i);
+        source.Insert(i + 1000);
+    }
+    reader.join();
+    assert(broken == 0 && source.Size() == 1000 && source.GetMin() == 1000);
+
+    cout << "PASSED!" << endl << endl;
+}
+
+void TestSaveAndLoad() {
+    cout << "Testing Save and Load..." << endl;
+    const string path = "rbt-tests-save.bin";
+    RedBlackTree tree;
+    mt19937 gen(18);
+    for (int i = 0; i < 5000; i++) {
+        tree.TryInsert(static_cast<int>(gen() % 100000) - 50000);
+    }
+    tree.Save(path);
+
+    RedBlackTree loaded;
+    loaded.Insert(123456);
+    loaded.Load(path);
+    assert(loaded.Size() == tree.Size());
+    assert(equal(loaded.begin(), loaded.end(), tree.begin(), tree.end()));
+    loaded.Insert(123456);
+
+    // The mapped tree answers from the file without loading it
+    MappedRedBlackTree<int> mapped(path);
+    assert(mapped.Size() == tree.Size());
+    assert(mapped.GetMin() == tree.GetMin() && mapped.GetMax() == tree.GetMax());
+    for (int key = -50100; key < 50100; key += 7) {
+        assert(mapped.Contains(key) == tree.Contains(key));
+    }
+    assert(equal(mapped.begin(), mapped.end(), tree.begin(), tree.end()));
+    MappedRedBlackTree<int> moved(move(mapped));
+    assert(moved.Size() == tree.Size() && mapped.Size() == 0);
+
+    // Maps keep their values, in memory and mapped
+    RedBlackTreeMap<int, double> prices;
+    for (int i = 0; i < 100; i++) {
+        prices.Emplace(i * 3, i * 0.5);
+    }
+    prices.Save(path);
+    RedBlackTreeMap<int, double> loadedPrices;
+    loadedPrices.Load(path);
+    assert(loadedPrices.Size() == 100 && loadedPrices.At(297) == 49.5);
+    MappedRedBlackTree<int, double> mappedPrices(path);
+    assert(*mappedPrices.GetValue(30) == 5.0 && mappedPrices.GetValue(31) == nullptr);
+
+    // A file of other types or a damaged file is refused and leaves the tree alone
+    bool threw = false;
+    try {
+        loaded.Load(path);
+    } catch (const invalid_argument &e) {
+        threw = true;
+    }
+    assert(threw && loaded.Size() == tree.Size() + 1);
+
+    RedBlackTree empty;
+    empty.Save(path);
+    loaded.Load(path);
+    assert(loaded.Size() == 0 && MappedRedBlackTree<int>(path).Size() == 0);
+    threw = false;
+    try {
+        MappedRedBlackTree<int>(path).GetMin();
+    } catch (const underflow_error &e) {
+        threw = true;
+    }
+    assert(threw);
+
+    FILE *file = fopen(path.c_str(), "wb");
+    fputs("not a tree", file);
+    fclose(file);
+    threw = false;
+    try {
+        MappedRedBlackTree<int> broken(path);
+    } catch (const invalid_argument &e) {
+        threw = true;
+    }
+    assert(threw);
+    remove(path.c_str());
+
+    threw = false;
+    try {
+        loaded.Load(path);
+    } catch (const runtime_error &e) {
+        threw = true;
+    }
+    assert(threw);
+
+    cout << "PASSED!" << endl << endl;
+}
+
+void TestIntStream() {
+    cout << "Testing Streaming Int Input and Output..." << endl;
+    // A mapped file, with every kind of whitespace and the int extremes
+    const string path = "rbt-tests-ints.txt";
+    FILE *file = fopen(path.c_str(), "wb");
+    fputs("  5 -3\n\n2147483647\t-2147483648\r\n5 17", file);
+    fclose(file);
+    vector<int> batch;
+    {
+        IntReader reader(path);
+        assert(reader.ReadBatch(batch, 4) == 4);
+        assert((batch == vector<int>{5, -3, 2147483647, -2147483648}));
+        assert(reader.ReadBatch(batch, 4) == 2);
+        assert((batch == vector<int>{5, 17}));
+        assert(!reader.AtEnd());
+        assert(reader.ReadBatch(batch, 4) == 0 && reader.AtEnd());
+        assert(reader.ParseStats().keys == 6);
+    }
+
+    // Library API: ingest, then answer queries into an output pipe
+    {
+        RedBlackTree rbt;
+        StageStats insertStats;
+        IntReader keys(path);
+        assert(IngestInts(rbt, keys, insertStats, 2) == 5);
+        assert(insertStats.keys == 6);
+        assert(rbt.Size() == 5 && rbt.GetMin() == -2147483648 && rbt.GetMax() == 2147483647);
+
+        int fds[2];
+        int opened = pipe(fds);
+        assert(opened == 0);
+        FILE *queriesFile = fopen(path.c_str(), "wb");
+        fputs("17 4 -3 0", queriesFile);
+        fclose(queriesFile);
+        IntReader queries(path);
+        StageStats queryStats;
+        {
+            OutputBuffer output(fds[1], 0);
+            assert(QueryInts(rbt, queries, output, queryStats, 3) == 2);
+            output.Append(-42);
+            output.Append('\n');
+            output.Flush();
+            assert(output.Stats().bytes == 12);
+        }
+        close(fds[1]);
+        char text[64] = {};
+        size_t got = 0;
+        ssize_t n;
+        while ((n = read(fds[0], text + got, sizeof(text) - 1 - got)) > 0) {
+            got += n;
+        }
+        close(fds[0]);
+        assert(string(text, got) == "1\n0\n1\n0\n-42\n");
+        assert(queryStats.keys == 4);
+    }
+
+    // A pipe read through a tiny buffer, so numbers straddle the refills
+    {
+        int fds[2];
+        int opened = pipe(fds);
+        assert(opened == 0);
+        vector<int> expected;
+        string text;
+        mt19937 gen(29);
+        uniform_int_distribution<int> dist(numeric_limits<int>::min(), numeric_limits<int>::max());
+        for (int i = 0; i < 3000; i++) {
+            expected.push_back(dist(gen));
+            text += to_string(expected.back()) + ((i % 7 == 0) ? "\n" : "  ");
+        }
+        thread writer([&]() {
+            for (size_t at = 0; at < text.size(); at += 1000) {
+                size_t length = min<size_t>(1000, text.size() - at);
+                ssize_t put = write(fds[1], text.data() + at, length);
+                assert(put == static_cast<ssize_t>(length));
+            }
+            close(fds[1]);
+        });
+        IntReader reader(fds[0], 1);
+        vector<int> all;
+        while (reader.ReadBatch(batch, 100) != 0) {
+            all.insert(all.end(), batch.begin(), batch.end());
+        }
+        writer.join();
+        close(fds[0]);
+        assert(all == expected);
+        assert(reader.ReadStats().bytes == text.size());
+        assert(reader.ParseStats().bytes == text.size());
+    }
+
+    // Zero padded numbers longer than the lookahead, and than the buffer, stay whole
+    {
+        int fds[2];
+        int opened = pipe(fds);
+        assert(opened == 0);
+        string text = "1 " + string(40, '0') + "42 -" + string(100, '0') + "7 8";
+        thread writer([&]() {
+            ssize_t put = write(fds[1], text.data(), text.size());
+            assert(put == static_cast<ssize_t>(text.size()));
+            close(fds[1]);
+        });
+        IntReader reader(fds[0], 32);
+        vector<int> all;
+        while (reader.ReadBatch(batch, 100) != 0) {
+            all.insert(all.end(), batch.begin(), batch.end());
+        }
+        writer.join();
+        close(fds[0]);
+        assert((all == vector<int>{1, 42, -7, 8}));
+        assert(reader.ParseStats().bytes == text.size());
+    }
+
+    // Bad input names the byte it starts at
+    auto fails = [&](const char *text, bool range) {
+        FILE *bad = fopen(path.c_str(), "wb");
+        fputs(text, bad);
+        fclose(bad);
+        IntReader reader(path);
+        try {
+            reader.ReadBatch(batch, 10);
+        } catch (const out_of_range &e) {
+            return range;
+        } catch (const invalid_argument &e) {
+            return !range && string(e.what()).find("byte 3") != string::npos;
+        }
+        return false;
+    };
+    assert(fails("12 x4", false));
+    assert(fails("12 4x", false));
+    assert(fails("12 99999999999", true));
+    remove(path.c_str());
+
+    bool threw = false;
+    try {
+        IntReader missing(path);
+    } catch (const runtime_error &e) {
+        threw = true;
+    }
+    assert(threw);
+
+    cout << "PASSED!" << endl << endl;
+}
+
+void TestFrozenTree() {
+    cout << "Testing Frozen Tree..." << endl;
+    // Every size up to a few full levels, so both complete and ragged
+    // bottom levels are searched
+    for (int size = 0; size <= 70; size++) {
+        RedBlackTree tree;
+        for (int i = 0; i < size; i++) {
+            tree.Insert(i * 2);
+        }
+        FrozenRedBlackTree<int> frozen = tree.Freeze();
+        assert(frozen.Size() == tree.Size());
+        vector<int> probes;
+        for (int key = -1; key <= size * 2; key++) {
+            assert(frozen.Contains(key) == tree.Contains(key));
+            probes.push_back(key);
+        }
+        unique_ptr<bool[]> found(new bool[probes.size()]);
+        frozen.ContainsMany(probes.data(), probes.size(), found.get());
+        for (size_t i = 0; i < probes.size(); i++) {
+            assert(found[i] == tree.Contains(probes[i]));
+        }
+        vector<int> keys;
+        frozen.ForEach([&](int key) { keys.push_back(key); });
+        assert(equal(keys.begin(), keys.end(), tree.begin(), tree.end()));
+        if (size > 0) {
+            assert(frozen.GetMin() == 0 && frozen.GetMax() == (size - 1) * 2);
+        }
+    }
+
+    RedBlackTree big;
+    mt19937 gen(19);
+    for (int i = 0; i < 100000; i++) {
+        big.TryInsert(static_cast<int>(gen() % 1000000));
+    }
+    FrozenRedBlackTree<int> frozenBig = big.Freeze();
+    FrozenRedBlackTree<int> copied = frozenBig;
+    for (int i = 0; i < 20000; i++) {
+        int key = static_cast<int>(gen() % 1000000);
+        assert(copied.Contains(key) == big.Contains(key));
+    }
+
+    // Values travel with their keys, and other orderings are kept
+    BasicRedBlackTree<string, int, greater<string>> counts;
+    counts.Emplace("apple", 3);
+    counts.Emplace("pear", 5);
+    counts.Emplace("fig", 1);
+    FrozenRedBlackTree<string, int, greater<string>> frozenCounts = counts.Freeze();
+    assert(*frozenCounts.GetValue("pear") == 5 && *frozenCounts.GetValue("fig") == 1);
+    assert(frozenCounts.GetValue("kiwi") == nullptr);
+    assert(frozenCounts.GetMin() == "pear" && frozenCounts.GetMax() == "apple");
+
+    FrozenRedBlackTree<int> empty;
+    assert(empty.Size() == 0 && !empty.Contains(1));
+    bool threw = false;
+    try {
+        empty.GetMin();
+    } catch (const underflow_error &e) {
+        threw = true;
+    }
+    assert(threw);
+
+    cout << "PASSED!" << endl << endl;
+}
+
+void TestBulkLoad() {
+    cout << "Testing Bulk Load..." << endl;
+    vector<int> seven = {1, 2, 3, 4, 5, 6, 7};
+    RedBlackTree perfect(seven.begin(), seven.end());
+    assert(perfect.Size() == 7);
+    assert(perfect.ToPrefixString() == " B4  B2  B1  B3  B6  B5  B7 ");
+
+    vector<int> five = {1, 2, 3, 4, 5};
+    RedBlackTree partial(five.begin(), five.end());
+    assert(partial.ToPrefixString() == " B3  B2  R1  B5  R4 ");
+
+    vector<int> unsorted = {9, 3, 5, 3, 1, 9};
+    RedBlackTree deduped(unsorted.begin(), unsorted.end());
+    assert(deduped.Size() == 4);
+    assert(deduped.ToInfixString() == " R1  B3  B5  B9 ");
+
+    vector<int> none;
+    RedBlackTree empty(none.begin(), none.end());
+    assert(empty.Size() == 0);
+    assert(empty.ToInfixString() == "");
+
+    bool threw = false;
+    try {
+        empty.BuildFromSorted(unsorted.begin(), unsorted.end());
+    } catch (invalid_argument &e) {
+        threw = true;
+    }
+    assert(threw);
+    assert(empty.Size() == 0);
+
+    vector<int> big;
+    for (int i = 0; i < 100000; i++) {
+        big.push_back(i * 2);
+    }
+    RedBlackTree rbt;
+    rbt.Insert(-5);
+    rbt.BuildFromSorted(big.begin(), big.end());
+    assert(rbt.Size() == big.size());
+    assert(!rbt.Contains(-5));
+    assert(rbt.GetMin() == 0);
+    assert(rbt.GetMax() == 199998);
+    for (int i = 0; i < 1000; i++) {
+        assert(rbt.Contains(i * 2));
+        assert(!rbt.Contains(i * 2 + 1));
+        rbt.Insert(i * 2 + 1);
+    }
+    assert(rbt.Size() == big.size() + 1000);
+
+    cout << "PASSED!" << endl << endl;
+}
+
+void TestShardedTree() {
+    cout << "Testing Sharded Tree..." << endl;
+    vector<int> boundaries = ShardedRedBlackTree<int>::EvenBoundaries(8, 0, 8000);
+    assert((boundaries == vector<int>{1000, 2000, 3000, 4000, 5000, 6000, 7000}));
+    ShardedRedBlackTree<int> sharded(boundaries);
+    assert(sharded.ShardCount() == 8);
+    assert(sharded.ShardOf(-5) == 0 && sharded.ShardOf(999) == 0 && sharded.ShardOf(1000) == 1);
+    assert(sharded.ShardOf(7999) == 7 && sharded.ShardOf(100000) == 7);
+    assert(sharded.begin() == sharded.end());
+
+    bool threw = false;
+    try {
+        sharded.GetMin();
+    } catch (const underflow_error &) {
+        threw = true;
+    }
+    assert(threw);
+
+    // Extremes that are not in the first or last shard
+    sharded.Insert(2500);
+    sharded.Insert(4500);
+    assert(sharded.GetMin() == 2500 && sharded.GetMax() == 4500);
+    assert(!sharded.TryInsert(2500));
+    assert(sharded.Remove(2500) && sharded.Remove(4500) && !sharded.Remove(4500));
+
+    // Writers spread over the shards, and keys outside the even split
+    const int threadCount = 4;
+    vector<thread> threads;
+    for (int t = 0; t < threadCount; t++) {
+        threads.emplace_back([&sharded, t]() {
+            for (int key = -500 + t; key < 9000; key += threadCount) {
+                sharded.Insert(key);
+            }
+            for (int key = -500 + t; key < 9000; key += 2 * threadCount) {
+                assert(sharded.Contains(key));
+                assert(sharded.Remove(key));
+            }
+        });
+    }
+    for (thread &th : threads) {
+        th.join();
+    }
+
+    set<int> expected;
+    for (int key = -500; key < 9000; key++) {
+        if ((key + 500) % (2 * threadCount) >= threadCount) expected.insert(key);
+    }
+    assert(sharded.Size() == expected.size());
+    assert(vector<int>(sharded.begin(), sharded.end()) == vector<int>(expected.begin(), expected.end()));
+    vector<int> visited;
+    sharded.ForEach([&visited](int key) { visited.push_back(key); });
+    assert(visited == vector<int>(expected.begin(), expected.end()));
+    assert(sharded.GetMin() == *expected.begin() && sharded.GetMax() == *expected.rbegin());
+
+    ShardedRedBlackTree<string, int> map({"g", "p"});
+    map.Insert("apple", 1);
+    map.Insert("melon", 2);
+    map.Insert("zucchini", 3);
+    int value = 0;
+    assert(map.TryGet("melon", value) && value == 2);
+    assert(!map.TryGet("kiwi", value));
+    assert(map.GetMin() == "apple" && map.GetMax() == "zucchini");
+    assert(map.begin().value() == 1);
+
+    threw = false;
+    try {
+        ShardedRedBlackTree<int> bad({5, 5});
+    } catch (const invalid_argument &) {
+        threw = true;
+    }
+    assert(threw);
+
+    cout << "PASSED!" << endl << endl;
+}
+
+void TestStats() {
+    cout << "Testing Stats..." << endl;
+    RedBlackTree rbt;
+    RBTStats stats = rbt.GetStats();
+    assert(stats.maxDepth == 0 && stats.blackHeight == 0 && stats.balanced);
+
+    rbt.Insert(1);
+    rbt.Insert(2);
+    rbt.Insert(3);
+    stats = rbt.GetStats();
+    assert(stats.maxDepth == 2);
+    assert(stats.averageDepth == 5.0 / 3);
+    assert(stats.blackHeight == 1 && stats.balanced);
+
+    // Increasing keys only ever take the right-right rotation
+    for (int i = 4; i <= 1024; i++) {
+        rbt.Insert(i);
+    }
+    rbt.TryInsert(512);
+    stats = rbt.GetStats();
+    assert(stats.balanced);
+    assert(stats.maxDepth <= 20 && stats.averageDepth <= stats.maxDepth);
+    assert(stats.blackHeight >= 5 && stats.blackHeight <= 11);
+
+    for (int i = 1; i <= 1024; i += 2) {
+        rbt.Remove(i);
+    }
+    assert(!rbt.Contains(1) && rbt.Contains(2));
+    stats = rbt.GetStats();
+    assert(stats.balanced);
+
+#ifdef RBT_ENABLE_STATS
+    assert(stats.countersEnabled);
+    assert(stats.insertDescents == 1025);
+    assert(stats.insertComparisons >= 1024 * 9);
+    assert(stats.insertInnerRotations == 0);
+    assert(stats.insertOuterRotations > 0 && stats.insertRecolorCases > 0);
+    // Every fix up case that rotates does so once, the inner insert case too
+    // before it falls into the outer one
+    unsigned long long rotations = stats.insertOuterRotations + stats.insertInnerRotations +
+        stats.removeCases[0] + stats.removeCases[2] + stats.removeCases[3];
+    assert(stats.leftRotations + stats.rightRotations == rotations);
+    // Each Remove and the two Contains searched once
+    assert(stats.searches == 512 + 2);
+    assert(stats.ComparisonsPerSearch() >= 1 && stats.ComparisonsPerSearch() <= 20);
+    assert(stats.recolors > 0);
+
+    rbt.ResetStats();
+    rbt.Contains(2);
+    stats = rbt.GetStats();
+    assert(stats.searches == 1 && stats.insertDescents == 0 && stats.leftRotations == 0);
+#else
+    assert(!stats.countersEnabled);
+    assert(stats.searches == 0 && stats.insertDescents == 0 && stats.leftRotations == 0);
+#endif
+
+    cout << "PASSED!" << endl << endl;
+}
+
+// Key that counts its live instances and can be told to fail a copy.
+struct TrackedKey {
+    static int live;
+    static int copiesBeforeThrow;
+    int v;
+
+    TrackedKey(int v) : v(v) { live++; }
+    TrackedKey(const TrackedKey &other) : v(other.v) {
+        if (copiesBeforeThrow >= 0 && copiesBeforeThrow-- == 0) throw runtime_error("copy failed");
+        live++;
+    }
+    TrackedKey(TrackedKey &&other) noexcept : v(other.v) { live++; }
+    ~TrackedKey() { live--; }
+    bool operator<(const TrackedKey &other) const { return v < other.v; }
+};
+int TrackedKey::live = 0;
+int TrackedKey::copiesBeforeThrow = -1;
+
+void TestValidate() {
+    cout << "Testing Validate Against std::set..." << endl;
+    string problem;
+    RedBlackTree empty;
+    assert(empty.Validate(&problem) && problem.empty());
+    assert(CompactRedBlackTree().Validate() && BucketedRedBlackTree().Validate());
+
+    // Every engine checked after every call of a random stream
+    mt19937 gen(30);
+    uniform_int_distribution<int> dist(0, 300);
+    RedBlackTree rbt;
+    RankedRedBlackTree ranked;
+    BucketedRedBlackTree bucketed;
+    CompactRedBlackTree compact;
+    ShardedRedBlackTree<int> sharded(ShardedRedBlackTree<int>::EvenBoundaries(8, 0, 300));
+    set<int> expected;
+    for (int i = 0; i < 3000; i++) {
+        int key = dist(gen);
+        if (i < 1000 || i % 3 != 0) {
+            bool added = expected.insert(key).second;
+            assert(rbt.TryInsert(key) == added && ranked.TryInsert(key) == added);
+            assert(bucketed.TryInsert(key) == added && sharded.TryInsert(key) == added);
+            if (i < 1000) assert(compact.TryInsert(key) == added);
+        } else {
+            bool removed = expected.erase(key) == 1;
+            assert(rbt.Remove(key) == removed && ranked.Remove(key) == removed);
+            assert(bucketed.Remove(key) == removed && sharded.Remove(key) == removed);
+        }
+        assert(rbt.Validate(&problem) && ranked.Validate(&problem));
+        assert(bucketed.Validate(&problem) && sharded.Validate(&problem));
+        assert(compact.Validate(&problem));
+        assert(equal(rbt.begin(), rbt.end(), expected.begin(), expected.end()));
+        assert(bucketed.Size() == expected.size() && sharded.Size() == expected.size());
+    }
+    vector<int> bucketedKeys;
+    bucketed.ForEach([&bucketedKeys](int key) { bucketedKeys.push_back(key); });
+    assert(equal(bucketedKeys.begin(), bucketedKeys.end(), expected.begin(), expected.end()));
+    vector<int> compactKeys;
+    compact.ForEach([&compactKeys](int key) { compactKeys.push_back(key); });
+    assert(is_sorted(compactKeys.begin(), compactKeys.end()) && compactKeys.size() == compact.Size());
+
+    // Trees rebuilt wholesale stay valid too
+    RedBlackTree greater = rbt.Split(150);
+    assert(rbt.Validate(&problem) && greater.Validate(&problem));
+    rbt.Join(move(greater));
+    assert(rbt.Validate(&problem) && greater.Validate(&problem));
+    RedBlackTree other;
+    for (int key = 0; key < 600; key += 7) {
+        other.Insert(key);
+    }
+    rbt.Union(move(other));
+    assert(rbt.Validate(&problem));
+    vector<int> sorted(expected.begin(), expected.end());
+    RedBlackTree built(sorted.begin(), sorted.end());
+    assert(built.Validate(&problem));
+    built.Clear();
+    assert(built.Validate(&problem));
+
+    cout << "PASSED!" << endl << endl;
+}
+
+void TestClearAndCopy() {
+    cout << "Testing Clear and Copy..." << endl;
+    RedBlackTree rbt;
+    for (int i = 0; i < 10000; i++) {
+        rbt.Insert(i * 3 % 10007);
+    }
+    size_t capacity = rbt.Capacity();
+    rbt.Clear();
+    assert(rbt.Size() == 0 && rbt.begin() == rbt.end());
+    assert(!rbt.Contains(3));
+    assert(rbt.Capacity() == capacity);
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 10000; i++) {
+            rbt.Insert(i);
+        }
+        assert(rbt.Size() == 10000 && rbt.GetStats().balanced);
+        assert(rbt.Capacity() == capacity);
+        rbt.Clear();
+    }
+
+    // Copies keep the shape and the subtree sizes
+    RankedRedBlackTree ranked;
+    for (int i = 0; i < 5000; i++) {
+        ranked.Insert(i * 7 % 5003);
+    }
+    RankedRedBlackTree rankedCopy(ranked);
+    assert(rankedCopy.ToPrefixString() == ranked.ToPrefixString());
+    for (int k = 0; k < 5000; k += 97) {
+        assert(rankedCopy.Select(k) == ranked.Select(k));
+    }
+
+    {
+        RedBlackTreeMap<TrackedKey, string> tracked;
+        for (int i = 0; i < 1000; i++) {
+            tracked.Emplace(TrackedKey(i), "value");
+        }
+        assert(TrackedKey::live == 1000);
+
+        // A copy that fails part way leaves nothing behind
+        TrackedKey::copiesBeforeThrow = 600;
+        bool threw = false;
+        try {
+            RedBlackTreeMap<TrackedKey, string> copy(tracked);
+        } catch (const runtime_error &) {
+            threw = true;
+        }
+        TrackedKey::copiesBeforeThrow = -1;
+        assert(threw);
+        assert(TrackedKey::live == 1000);
+
+        // So does a bulk load, and the tree keeps what it held: the 500 keys
+        // are copied once into a buffer, and node 300 fails
+        vector<TrackedKey> sorted;
+        for (int i = 0; i < 500; i++) {
+            sorted.emplace_back(i * 2);
+        }
+        TrackedKey::copiesBeforeThrow = 800;
+        threw = false;
+        try {
+            tracked.BuildFromSorted(sorted.begin(), sorted.end());
+        } catch (const runtime_error &) {
+            threw = true;
+        }
+        TrackedKey::copiesBeforeThrow = -1;
+        assert(threw);
+        assert(TrackedKey::live == 1500);
+        assert(tracked.Size() == 1000 && tracked.Validate() && tracked.At(TrackedKey(999)) == "value");
+        sorted.clear();
+
+        RedBlackTreeMap<TrackedKey, string> copy(tracked);
+        assert(TrackedKey::live == 2000 && copy.Size() == 1000);
+        copy.Clear();
+        assert(TrackedKey::live == 1000 && copy.Size() == 0);
+        copy.Emplace(TrackedKey(5), "again");
+        assert(copy.At(TrackedKey(5)) == "again");
+    }
+    assert(TrackedKey::live == 0);
+
+    cout << "PASSED!" << endl << endl;
+}
+
+// Writes key to tree, or removes it, failing the first key copy, then the
+// second and so on until the write gets through. Every failed write must
+// leave the tree and the live key count as they were.
+template <class Tree>
+static void FailEachCopy(Tree &tree, int key, bool insert) {
+    for (int failAt = 0;; failAt++) {
+        size_t size = tree.Size();
+        int live = TrackedKey::live;
+        TrackedKey::copiesBeforeThrow = failAt;
+        bool threw = false;
+        try {
+            bool changed = insert ? tree.TryInsert(TrackedKey(key)) : tree.Remove(TrackedKey(key));
+            assert(changed);
+        } catch (const runtime_error &) {
+            threw = true;
+        }
+        TrackedKey::copiesBeforeThrow = -1;
+        if (!threw) {
+            assert(tree.Size() == (insert ? size + 1 : size - 1));
+            return;
+        }
+        assert(tree.Size() == size && TrackedKey::live == live);
+    }
+}
+
+// Keys of a path copying tree in order.
+template <class Tree>
+static vector<int> TrackedKeysOf(const Tree &tree) {
+    vector<int> keys;
+    tree.ForEach([&keys](const TrackedKey &key) { keys.push_back(key.v); });
+    return keys;
+}
+
+void TestFailedPathCopy() {
+    cout << "Testing failed writes on the path copying trees..." << endl;
+    {
+        PersistentRedBlackTree<TrackedKey> tree;
+        for (int i = 0; i < 500; i++) {
+            tree.Insert(TrackedKey(i * 2));
+        }
+        PersistentRedBlackTree<TrackedKey> snapshot = tree.Snapshot();
+        vector<int> before = TrackedKeysOf(tree);
+        for (int key = 1; key < 100; key += 10) {
+            FailEachCopy(tree, key, true);
+            FailEachCopy(tree, key + 1, false);
+        }
+        assert(TrackedKeysOf(snapshot) == before);
+        vector<int> after = TrackedKeysOf(tree);
+        assert(after.size() == 500 && after[1] == 1 && after[2] == 4);
+    }
+    assert(TrackedKey::live == 0);
+
+    {
+        // A failed write must not leave retired nodes behind either, or a
+        // later write would free nodes the tree still uses
+        ConcurrentRedBlackTree<TrackedKey> tree;
+        for (int i = 0; i < 500; i++) {
+            tree.Insert(TrackedKey(i * 2));
+        }
+        for (int key = 1; key < 100; key += 10) {
+            FailEachCopy(tree, key, true);
+            FailEachCopy(tree, key + 1, false);
+        }
+        for (int i = 200; i < 400; i += 2) {
+            tree.Remove(TrackedKey(i));
+        }
+        vector<int> after = TrackedKeysOf(tree);
+        assert(after.size() == 400 && after[1] == 1 && after[2] == 4);
+        assert(is_sorted(after.begin(), after.end()));
+    }
+    assert(TrackedKey::live == 0);
+
+    cout << "PASSED!" << endl << endl;
+}
+
+void TestMemoryResources() {
+    cout << "Testing Memory Resources and Page Arenas..." << endl;
+    // Any memory_resource supplies the node blocks
+    pmr::monotonic_buffer_resource buffer;
+    PmrRedBlackTree small(&buffer);
+    for (int i = 0; i < 100; i++) {
+        small.Insert((i * 37) % 100);
+    }
+    assert(small.Size() == 100 && small.GetMin() == 0 && small.GetMax() == 99);
+    assert(small.GetAllocator().resource() == &buffer);
+
+    // Chunks come in whole huge pages on huge page boundaries
+    PageArenaOptions options;
+    options.chunkBytes = 1;
+    options.numaNode = 0;
+    PageArenaResource arena(options);
+    assert(arena.BytesMapped() == 0);
+    PmrRedBlackTree tree(&arena);
+    set<int> expected;
+    mt19937 gen(28);
+    uniform_int_distribution<int> dist(0, 1 << 20);
+    for (int i = 0; i < 50000; i++) {
+        int key = dist(gen);
+        assert(tree.TryInsert(key) == expected.insert(key).second);
+    }
+    assert(arena.BytesMapped() >= PageArenaResource::HUGE_PAGE_BYTES);
+    assert(arena.BytesMapped() % PageArenaResource::HUGE_PAGE_BYTES == 0);
+    assert(arena.BytesUsed() <= arena.BytesMapped());
+    assert(equal(tree.begin(), tree.end(), expected.begin(), expected.end()));
+
+    // A replica placed in a second arena, and one made from a plain tree
+    PageArenaResource replicaArena;
+    PmrRedBlackTree replica(tree, &replicaArena);
+    assert(replica.GetAllocator().resource() == &replicaArena);
+    assert(equal(replica.begin(), replica.end(), expected.begin(), expected.end()));
+    assert(replicaArena.BytesUsed() > 0);
+    RedBlackTree plain(expected.begin(), expected.end());
+    PmrRedBlackTree fromPlain(&replicaArena);
+    fromPlain.BuildFromSorted(plain.begin(), plain.end());
+    assert(equal(fromPlain.begin(), fromPlain.end(), expected.begin(), expected.end()));
+
+    // Moving between arenas moves the keys, moving within one just the nodes
+    PmrRedBlackTree moved(&arena);
+    moved = move(replica);
+    assert(moved.GetAllocator().resource() == &arena);
+    assert(replica.Size() == 0);
+    assert(equal(moved.begin(), moved.end(), expected.begin(), expected.end()));
+    size_t used = arena.BytesUsed();
+    PmrRedBlackTree stolen(&arena);
+    stolen = move(moved);
+    assert(arena.BytesUsed() == used);
+    assert(stolen.Size() == expected.size() && moved.Size() == 0);
+
+    // The arena never takes memory back, so Clear reuses the pool's blocks
+    // where they are and refilling to the same size takes nothing new
+    size_t arenaUsed = arena.BytesUsed();
+    size_t capacity = tree.Capacity();
+    tree.Clear();
+    assert(tree.Size() == 0);
+    for (int i = 0; i < 1000; i++) {
+        tree.Insert(i);
+    }
+    assert(tree.Size() == 1000 && tree.GetMax() == 999);
+
+    for (int round = 0; round < 3; round++) {
+        tree.Clear();
+        for (int i = 0; i < 50000; i++) {
+            tree.Insert((i * 7919) % 50000);
+        }
+        assert(tree.Size() == 50000 && tree.Validate());
+        assert(arena.BytesUsed() == arenaUsed && tree.Capacity() == capacity);
+    }
+    PmrRedBlackTree upper = tree.Split(25000);
+    tree.Clear();
+    assert(tree.Capacity() == 0 && upper.Size() == 25000 && upper.Validate());
+
+    bool threw = false;
+    try {
+        PageArenaOptions bad;
+        bad.numaNode = 64;
+        PageArenaResource invalid(bad);
+    } catch (invalid_argument &e) {
+        threw = true;
+    }
+    assert(threw);
+
+    cout << "PASSED!" << endl << endl;
+}
+
+void TestIncrementalRebuild() {
+    cout << "Testing Incremental Copy and Freeze..." << endl;
+    RedBlackTree rbt;
+    for (int i = 0; i < 5000; i++) {
+        rbt.Insert(i * 13 % 5011);
+    }
+
+    IncrementalCopy<RedBlackTree> copier(rbt);
+    size_t steps = 0;
+    while (!copier.Step(100)) {
+        // The source keeps answering between steps
+        assert(rbt.Contains(13) && !rbt.Contains(5012));
+        steps++;
+    }
+    assert(steps == 49);
+    RedBlackTree copy = copier.Result();
+    assert(copy.ToPrefixString() == rbt.ToPrefixString());
+    copy.Insert(-1);
+    assert(!rbt.Contains(-1));
+
+    IncrementalCopy<RedBlackTree> unfinished(rbt);
+    unfinished.Step(10);
+    bool threw = false;
+    try {
+        unfinished.Result();
+    } catch (const logic_error &) {
+        threw = true;
+    }
+    assert(threw);
+
+    RedBlackTree none;
+    IncrementalCopy<RedBlackTree> empty(none);
+    assert(empty.Done() && empty.Result().Size() == 0);
+
+    // Subtree sizes and values come along too
+    RankedRedBlackTree ranked(copy.begin(), copy.end());
+    IncrementalCopy<RankedRedBlackTree> rankedCopier(ranked);
+    while (!rankedCopier.Step(1)) {}
+    RankedRedBlackTree rankedCopy = rankedCopier.Result();
+    assert(rankedCopy.Rank(2500) == ranked.Rank(2500) && rankedCopy.Select(77) == ranked.Select(77));
+
+    RedBlackTreeMap<int, string> map;
+    for (int i = 0; i < 300; i++) {
+        map.Emplace(i, to_string(i));
+    }
+    IncrementalFreeze<RedBlackTreeMap<int, string>> freezer(map);
+    assert(!freezer.Done());
+    while (!freezer.Step(64)) {}
+    auto frozen = freezer.Result();
+    assert(frozen.Size() == 300);
+    for (int i = 0; i < 300; i++) {
+        assert(*frozen.GetValue(i) == to_string(i));
+    }
+    assert(frozen.GetValue(300) == nullptr);
+
+    cout << "PASSED!" << endl << endl;
+}
+
+void TestLargeTreeAndCopy() {
+    cout << "Testing Large Tree and Copy..." << endl;
+    RedBlackTree rbt;
+    mt19937 gen(42);
+    uniform_int_distribution<int> dist(-1000000, 1000000);
+    for (int i = 0; i < 20000; i++) {
+        int value = dist(gen);
+        rbt.TryInsert(value);
+    }
+
+    RedBlackTree copy(rbt);
+    assert(copy.Size() == rbt.Size());
+    assert(copy.ToInfixString() == rbt.ToInfixString());
+    assert(copy.GetMin() == rbt.GetMin());
+    assert(copy.GetMax() == rbt.GetMax());
+
+    copy.Insert(2000000);
+    assert(copy.Contains(2000000));
+    assert(!rbt.Contains(2000000));
+
+    cout << "PASSED!" << endl << endl;
+}
+
+template <size_t NodeBytes>
+void CheckBPlusTree() {
+    BPlusTree<NodeBytes> empty;
+    assert(empty.Size() == 0 && !empty.Contains(0));
+    bool threw = false;
+    try {
+        empty.GetMax();
+    } catch (const underflow_error &e) {
+        threw = true;
+    }
+    assert(threw);
+
+    // Random, ascending and descending inserts each split leaves and inner
+    // nodes differently
+    vector<vector<int>> orders(3);
+    mt19937 gen(20);
+    for (int i = 0; i < 20000; i++) {
+        orders[0].push_back(static_cast<int>(gen() % 100000) - 50000);
+        orders[1].push_back(i);
+        orders[2].push_back(-i);
+    }
+    for (const vector<int> &order : orders) {
+        BPlusTree<NodeBytes> tree;
+        set<int> expected;
+        for (int key : order) {
+            assert(tree.TryInsert(key) == expected.insert(key).second);
+        }
+        assert(tree.Size() == expected.size());
+        assert(tree.GetMin() == *expected.begin() && tree.GetMax() == *expected.rbegin());
+        for (int key = -50010; key <= 50010; key += 3) {
+            assert(tree.Contains(key) == (expected.count(key) == 1));
+        }
+        vector<int> keys;
+        tree.ForEach([&](int key) { keys.push_back(key); });
+        assert(equal(keys.begin(), keys.end(), expected.begin(), expected.end()));
+
+        threw = false;
+        try {
+            tree.Insert(*expected.begin());
+        } catch (const invalid_argument &e) {
+            threw = true;
+        }
+        assert(threw);
+    }
+
+    BPlusTree<NodeBytes> extremes;
+    extremes.Insert(INT32_MAX);
+    extremes.Insert(INT32_MIN);
+    assert(extremes.Contains(INT32_MAX) && extremes.Contains(INT32_MIN) && !extremes.Contains(0));
+}
+
+void TestBPlusTree() {
+    cout << "Testing B+ Tree..." << endl;
+    CheckBPlusTree<64>();
+    CheckBPlusTree<128>();
+    cout << "PASSED!" << endl << endl;
+}
+
+void TestBucketedTree() {
+    cout << "Testing Bucketed Tree..." << endl;
+    BucketedRedBlackTree empty;
+    assert(empty.Size() == 0 && !empty.Contains(0) && !empty.Remove(0));
+    bool threw = false;
+    try {
+        empty.GetMin();
+    } catch (const underflow_error &e) {
+        threw = true;
+    }
+    assert(threw);
+
+    // Mixed inserts and removes split and merge buckets all over the tree
+    BucketedRedBlackTree tree;
+    set<int> expected;
+    mt19937 gen(26);
+    for (int i = 0; i < 60000; i++) {
+        int key = static_cast<int>(gen() % 20000) - 10000;
+        if (i < 30000 || gen() % 2 == 0) {
+            assert(tree.TryInsert(key) == expected.insert(key).second);
+        } else {
+            assert(tree.Remove(key) == (expected.erase(key) == 1));
+        }
+        if (!expected.empty() && i % 97 == 0) {
+            assert(tree.GetMin() == *expected.begin() && tree.GetMax() == *expected.rbegin());
+        }
+    }
+    assert(tree.Size() == expected.size());
+    assert(tree.BucketCount() * 4 >= tree.Size() / BucketedRedBlackTree::BUCKET_KEYS);
+    for (int key = -10010; key <= 10010; key++) {
+        assert(tree.Contains(key) == (expected.count(key) == 1));
+    }
+    vector<int> keys;
+    tree.ForEach([&](int key) { keys.push_back(key); });
+    assert(equal(keys.begin(), keys.end(), expected.begin(), expected.end()));
+
+    threw = false;
+    try {
+        tree.Insert(*expected.begin());
+    } catch (const invalid_argument &e) {
+        threw = true;
+    }
+    assert(threw);
+
+    // Draining from either end merges the buckets away
+    for (int key : expected) {
+        assert(tree.Remove(key));
+    }
+    assert(tree.Size() == 0 && tree.BucketCount() == 1);
+    for (int i = 0; i < 1000; i++) {
+        tree.Insert(-i);
+    }
+    assert(tree.GetMin() == -999 && tree.GetMax() == 0);
+    for (int i = 999; i >= 0; i--) {
+        assert(tree.Remove(-i));
+    }
+    assert(tree.Size() == 0 && tree.BucketCount() == 1);
+
+    BucketedRedBlackTree extremes;
+    extremes.Insert(INT32_MAX);
+    extremes.Insert(INT32_MIN);
+    assert(extremes.Contains(INT32_MAX) && extremes.Contains(INT32_MIN) && !extremes.Contains(0));
+    assert(extremes.GetMin() == INT32_MIN && extremes.GetMax() == INT32_MAX);
+
+    cout << "PASSED!" << endl << endl;
+}
+
+void TestCompactTree() {
+    cout << "Testing Compact Tree..." << endl;
+    assert(sizeof(CompactRBTNode) == 16);
+
+    CompactRedBlackTree empty;
+    assert(empty.ToInfixString() == "");
+    assert(empty.Size() == 0);
+
+    CompactRedBlackTree crbt;
+    crbt.Insert(12);
+    crbt.Insert(11);
+    crbt.Insert(15);
+    crbt.Insert(5);
+    crbt.Insert(13);
+    crbt.Insert(7);
+    assert(crbt.ToPrefixString() == " B12  B7  R5  R11  B15  R13 ");
+    assert(crbt.ToInfixString() == " R5  B7  R11  B12  R13  B15 ");
+    assert(crbt.ToPostfixString() == " R5  R11  B7  R13  B15  B12 ");
+    assert(crbt.GetMin() == 5);
+    assert(crbt.GetMax() == 15);
+
+    // Same inserts must produce the same shape and colors as RedBlackTree
+    RedBlackTree rbt;
+    CompactRedBlackTree compact;
+    mt19937 gen(7);
+    uniform_int_distribution<int> dist(0, 50000);
+    for (int i = 0; i < 5000; i++) {
+        int value = dist(gen);
+        if (!rbt.Contains(value)) {
+            rbt.Insert(value);
+            compact.Insert(value);
+        }
+    }
+    assert(compact.Size() == rbt.Size());
+    assert(compact.ToPrefixString() == rbt.ToPrefixString());
+    assert(compact.Contains(rbt.GetMin()));
+    assert(!compact.Contains(50001));
+
+    try {
+        compact.Insert(rbt.GetMax());
+        assert(false);
+    } catch (invalid_argument &e) {
+    }
+
+    cout << "PASSED!" << endl << endl;
+}
+
 int main() {
     TestSimpleConstructor();
     TestConstructor();
@@ -236,10 +2203,40 @@ int main() {
     TestInsertFourthNode();
     TestInsertFifthNode();
     TestToStrings();
+    TestTraversals();
     TestInsertRandomTests();
     TestCopyConstructor();
+    TestMoveAndAssignment();
     TestContains();
+    TestContainsMany();
     TestGetMinimumMaximum();
+    TestCachedMinMax();
+    TestTryInsert();
+    TestInsertMany();
+    TestHintedInsert();
+    TestIteratorsAndRanges();
+    TestOrderStatistics();
+    TestGenericKeysAndValues();
+    TestRemove();
+    TestBulkLoad();
+    TestSaveAndLoad();
+    TestIntStream();
+    TestFrozenTree();
+    TestJoinSplitAndSetOperations();
+    TestParallelOperations();
+    TestConcurrentTree();
+    TestPersistentTree();
+    TestShardedTree();
+    TestStats();
+    TestValidate();
+    TestClearAndCopy();
+    TestFailedPathCopy();
+    TestMemoryResources();
+    TestIncrementalRebuild();
+    TestLargeTreeAndCopy();
+    TestCompactTree();
+    TestBPlusTree();
+    TestBucketedTree();
 
     cout << "ALL TESTS PASSED!!" << endl;
     return 0;
@@ -0,0 +1,77 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include "RedBlackTree.h"
+#include "ShardedRedBlackTree.h"
+
+/**
+ *
+ * Insert scaling of ShardedRedBlackTree against a RedBlackTree behind one
+ * global mutex. For every thread count from 1 to the maximum, the threads
+ * insert their share of the same random keys into an empty tree.
+ *
+ * Usage: ./sharded-bench [keys] [max threads] [shards]
+ *
+**/
+
+using namespace std;
+
+// Splits keys over threads threads that each call insert(key) for their
+// share, and returns the inserts per second in millions.
+template <class Insert>
+static double Run(const vector<int> &keys, size_t threads, Insert insert) {
+    auto start = chrono::steady_clock::now();
+    vector<thread> workers;
+    for (size_t t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            for (size_t i = t; i < keys.size(); i += threads) {
+                insert(keys[i]);
+            }
+        });
+    }
+    for (thread &worker : workers) {
+        worker.join();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return keys.size() / seconds / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+    size_t keyCount = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 2000000;
+    size_t maxThreads = (argc > 2) ? strtoull(argv[2], nullptr, 10) : thread::hardware_concurrency();
+    size_t shardCount = (argc > 3) ? strtoull(argv[3], nullptr, 10) : 256;
+    if (maxThreads == 0) maxThreads = 1;
+    if (shardCount == 0) shardCount = 1;
+
+    int keyRange = static_cast<int>(min<size_t>(keyCount * 2, 1 << 30));
+    mt19937 gen(1);
+    uniform_int_distribution<int> dist(0, keyRange);
+    vector<int> keys(keyCount);
+    for (int &key : keys) {
+        key = dist(gen);
+    }
+    vector<int> boundaries = ShardedRedBlackTree<int>::EvenBoundaries(shardCount, 0, keyRange);
+
+    cout << "keys: " << keyCount << ", shards: " << shardCount << endl;
+    cout << "threads | mutex Minserts/s | sharded Minserts/s" << endl;
+    for (size_t threads = 1; threads <= maxThreads; threads++) {
+        RedBlackTree locked;
+        mutex lock;
+        double mutexRate = Run(keys, threads, [&](int key) {
+            lock_guard<mutex> guard(lock);
+            locked.TryInsert(key);
+        });
+        ShardedRedBlackTree<int> sharded(boundaries);
+        double shardedRate = Run(keys, threads, [&](int key) { sharded.TryInsert(key); });
+        if (sharded.Size() != locked.Size()) {
+            cerr << "size mismatch" << endl;
+            return 1;
+        }
+        cout << threads << "       | " << mutexRate << " | " << shardedRate << endl;
+    }
+    return 0;
+}
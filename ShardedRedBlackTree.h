@@ -0,0 +1,308 @@
+#ifndef SHARDEDREDBLACKTREE_H
+#define SHARDEDREDBLACKTREE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "RedBlackTree.h"
+
+using namespace std;
+
+
+// ShardedRedBlackTree
+// Ordered set or map that many threads may write at once. The key space is
+// cut into ranges at fixed boundary keys and every range is an independent
+// BasicRedBlackTree with its own lock and its own node pool, so writers to
+// different ranges never wait for one another or share an allocator. Shard
+// i holds the keys k with boundaries[i - 1] <= k < boundaries[i]; the first
+// and last shards are open ended. Since the shards partition the key order,
+// walking them one after the other visits every key in order, and the
+// minimum and maximum are those of the first and last non-empty shards.
+// Writes scale with the number of threads only as far as their keys spread
+// over the shards, so the boundaries should split the expected keys evenly.
+template <class Key, class Value = NoValue, class Compare = less<Key>>
+class ShardedRedBlackTree {
+
+	public:
+		using Tree = BasicRedBlackTree<Key, Value, Compare>;
+
+		// In-order iterator across all shards. It reads the shards without
+		// locking them, so it may only be used while no thread writes.
+		class const_iterator {
+			public:
+				using iterator_category = forward_iterator_tag;
+				using value_type = Key;
+				using difference_type = ptrdiff_t;
+				using pointer = const Key *;
+				using reference = const Key &;
+
+				const_iterator() = default;
+
+				reference operator*() const { return *position; };
+				pointer operator->() const { return &*position; };
+				const Key &key() const { return position.key(); };
+				const Value &value() const { return position.value(); };
+
+				const_iterator &operator++() { ++position; SkipEmpty(); return *this; };
+				const_iterator operator++(int) { const_iterator old = *this; ++*this; return old; };
+
+				bool operator==(const const_iterator &other) const { return shard == other.shard && position == other.position; };
+				bool operator!=(const const_iterator &other) const { return !(*this == other); };
+
+			private:
+				friend class ShardedRedBlackTree;
+				const_iterator(const ShardedRedBlackTree *tree, size_t shard);
+				void SkipEmpty();
+
+				const ShardedRedBlackTree *tree = nullptr;
+				size_t shard = 0;
+				typename Tree::const_iterator position;
+		};
+		using iterator = const_iterator;
+
+		explicit ShardedRedBlackTree(vector<Key> boundaries, const Compare &comp = Compare());
+
+		ShardedRedBlackTree(const ShardedRedBlackTree &other) = delete;
+		ShardedRedBlackTree &operator=(const ShardedRedBlackTree &other) = delete;
+
+		static vector<Key> EvenBoundaries(size_t shardCount, const Key &low, const Key &high);
+
+		void Insert(const Key &key, const Value &value = Value());
+		bool TryInsert(const Key &key, const Value &value = Value());
+		bool Remove(const Key &key);
+
+		bool Contains(const Key &key) const;
+		bool TryGet(const Key &key, Value &value) const;
+		size_t Size() const;
+		Key GetMin() const;
+		Key GetMax() const;
+
+		template <class Visitor>
+		void ForEach(Visitor visit) const;
+
+		bool Validate(string *problem = nullptr) const;
+
+		size_t ShardCount() const { return shardCount; };
+		size_t ShardOf(const Key &key) const;
+
+		const_iterator begin() const { return const_iterator(this, 0); };
+		const_iterator end() const { return const_iterator(this, shardCount); };
+
+	private:
+		// One cache line apart, so locking one shard never bounces the line
+		// holding its neighbour's lock.
+		struct alignas(64) Shard {
+			mutable shared_mutex lock;
+			Tree tree;
+		};
+
+		Compare comp;
+		vector<Key> boundaries;
+		size_t shardCount;
+		unique_ptr<Shard[]> shards;
+};
+
+
+#define SRBT_TEMPLATE template <class Key, class Value, class Compare>
+#define SRBT_CLASS ShardedRedBlackTree<Key, Value, Compare>
+
+// Constructor
+// Makes boundaries.size() + 1 empty shards split at the given keys, which
+// must be strictly increasing; throws invalid_argument otherwise.
+SRBT_TEMPLATE
+SRBT_CLASS::ShardedRedBlackTree(vector<Key> boundaries, const Compare &comp)
+    : comp(comp), boundaries(move(boundaries)) {
+    for (size_t i = 1; i < this->boundaries.size(); i++) {
+        if (!comp(this->boundaries[i - 1], this->boundaries[i])) {
+            throw invalid_argument("Shard boundaries must be strictly increasing.");
+        }
+    }
+    shardCount = this->boundaries.size() + 1;
+    shards.reset(new Shard[shardCount]);
+    for (size_t i = 0; i < shardCount; i++) {
+        shards[i].tree = Tree(comp);
+    }
+}
+
+// EvenBoundaries
+// Boundaries that split [low, high] into shardCount ranges of equal width,
+// for arithmetic keys under the default ordering.
+SRBT_TEMPLATE
+vector<Key> SRBT_CLASS::EvenBoundaries(size_t shardCount, const Key &low, const Key &high) {
+    static_assert(is_arithmetic<Key>::value, "Even boundaries need arithmetic keys");
+    if (shardCount == 0 || !(low < high)) {
+        throw invalid_argument("Need at least one shard and low < high.");
+    }
+    vector<Key> result;
+    long double width = static_cast<long double>(high) - static_cast<long double>(low);
+    for (size_t i = 1; i < shardCount; i++) {
+        Key boundary = static_cast<Key>(low + width * i / shardCount);
+        if (result.empty() ? low < boundary : result.back() < boundary) {
+            result.push_back(boundary);
+        }
+    }
+    return result;
+}
+
+// ShardOf
+// Index of the shard whose range holds key: the number of boundaries not
+// greater than it.
+SRBT_TEMPLATE
+size_t SRBT_CLASS::ShardOf(const Key &key) const {
+    return static_cast<size_t>(upper_bound(boundaries.begin(), boundaries.end(), key, comp) - boundaries.begin());
+}
+
+// Insert
+// Adds a key, throwing invalid_argument if it is already present.
+SRBT_TEMPLATE
+void SRBT_CLASS::Insert(const Key &key, const Value &value) {
+    if (!TryInsert(key, value)) {
+        throw invalid_argument("Duplicate entry not allowed.");
+    }
+}
+
+// TryInsert
+// Same as Insert, but reports a duplicate by returning false instead of
+// throwing. Only the key's shard is locked.
+SRBT_TEMPLATE
+bool SRBT_CLASS::TryInsert(const Key &key, const Value &value) {
+    Shard &shard = shards[ShardOf(key)];
+    unique_lock<shared_mutex> guard(shard.lock);
+    return shard.tree.Emplace(key, value).second;
+}
+
+// Remove
+// Deletes a key. Returns false if it was not present.
+SRBT_TEMPLATE
+bool SRBT_CLASS::Remove(const Key &key) {
+    Shard &shard = shards[ShardOf(key)];
+    unique_lock<shared_mutex> guard(shard.lock);
+    return shard.tree.Remove(key);
+}
+
+// Contains
+// Returns true if the key is present. Readers of one shard share its lock.
+SRBT_TEMPLATE
+bool SRBT_CLASS::Contains(const Key &key) const {
+    const Shard &shard = shards[ShardOf(key)];
+    shared_lock<shared_mutex> guard(shard.lock);
+    return shard.tree.Contains(key);
+}
+
+// TryGet
+// Copies the value stored under key into value and returns true, or returns
+// false if the key is not present. The value is copied out because the node
+// may be removed as soon as the shard is unlocked.
+SRBT_TEMPLATE
+bool SRBT_CLASS::TryGet(const Key &key, Value &value) const {
+    const Shard &shard = shards[ShardOf(key)];
+    shared_lock<shared_mutex> guard(shard.lock);
+    const Value *found = shard.tree.GetValue(key);
+    if (found == nullptr) return false;
+    value = *found;
+    return true;
+}
+
+// Size
+// Number of keys, summed over the shards one at a time. With concurrent
+// writers the total may mix moments, as with any sum of live counters.
+SRBT_TEMPLATE
+size_t SRBT_CLASS::Size() const {
+    size_t total = 0;
+    for (size_t i = 0; i < shardCount; i++) {
+        shared_lock<shared_mutex> guard(shards[i].lock);
+        total += shards[i].tree.Size();
+    }
+    return total;
+}
+
+// GetMin
+// Returns the smallest key, found in the first shard that is not empty.
+// Throws underflow_error if every shard is empty.
+SRBT_TEMPLATE
+Key SRBT_CLASS::GetMin() const {
+    for (size_t i = 0; i < shardCount; i++) {
+        shared_lock<shared_mutex> guard(shards[i].lock);
+        if (shards[i].tree.Size() > 0) return shards[i].tree.GetMin();
+    }
+    throw underflow_error("Tree is empty.");
+}
+
+// GetMax
+// Returns the largest key, found in the last shard that is not empty.
+// Throws underflow_error if every shard is empty.
+SRBT_TEMPLATE
+Key SRBT_CLASS::GetMax() const {
+    for (size_t i = shardCount; i-- > 0;) {
+        shared_lock<shared_mutex> guard(shards[i].lock);
+        if (shards[i].tree.Size() > 0) return shards[i].tree.GetMax();
+    }
+    throw underflow_error("Tree is empty.");
+}
+
+// ForEach
+// Calls visit(key) in key order, holding each shard's lock while it is
+// being visited. Each shard is seen at one moment, but writes can land in
+// a shard before or after it has been visited. visit must not write to
+// the tree.
+SRBT_TEMPLATE
+template <class Visitor>
+void SRBT_CLASS::ForEach(Visitor visit) const {
+    for (size_t i = 0; i < shardCount; i++) {
+        shared_lock<shared_mutex> guard(shards[i].lock);
+        shards[i].tree.ForEach(visit);
+    }
+}
+
+// Validate
+// Checks every shard with RedBlackTree::Validate under its read lock, and
+// that the shard's smallest and largest keys lie within its boundaries.
+// Returns false at the first violation and, if problem is given,
+// describes it there.
+SRBT_TEMPLATE
+bool SRBT_CLASS::Validate(string *problem) const {
+    for (size_t i = 0; i < shardCount; i++) {
+        shared_lock<shared_mutex> guard(shards[i].lock);
+        const Tree &tree = shards[i].tree;
+        if (!tree.Validate(problem)) return false;
+        if (tree.Size() == 0) continue;
+        if ((i > 0 && comp(tree.GetMin(), boundaries[i - 1])) ||
+                (i + 1 < shardCount && !comp(tree.GetMax(), boundaries[i]))) {
+            if (problem != nullptr) *problem = "Key outside its shard's boundaries.";
+            return false;
+        }
+    }
+    return true;
+}
+
+// const_iterator
+// Starts at the first key of the first non-empty shard from shard on.
+SRBT_TEMPLATE
+SRBT_CLASS::const_iterator::const_iterator(const ShardedRedBlackTree *tree, size_t shard) : tree(tree), shard(shard) {
+    if (shard < tree->shardCount) position = tree->shards[shard].tree.begin();
+    SkipEmpty();
+}
+
+// SkipEmpty
+// Moves on past the end of the current shard, and any empty ones, so the
+// iterator is either on a key or equal to end().
+SRBT_TEMPLATE
+void SRBT_CLASS::const_iterator::SkipEmpty() {
+    while (shard < tree->shardCount && position == tree->shards[shard].tree.end()) {
+        shard++;
+        position = (shard < tree->shardCount) ? tree->shards[shard].tree.begin() : typename Tree::const_iterator();
+    }
+}
+
+#undef SRBT_CLASS
+#undef SRBT_TEMPLATE
+
+#endif
@@ -0,0 +1,209 @@
+#ifndef TASKPOOL_H
+#define TASKPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+
+
+// TaskPool
+// Work stealing fork-join pool for the divide and conquer tree algorithms.
+// Every worker owns a deque: it pushes and takes its own tasks at the back,
+// while idle workers steal from the front of the others, so the big
+// subproblems near the top of a recursion are the ones that move between
+// cores. A thread waiting on a forked task runs queued work instead of
+// blocking, so nested Invoke calls cannot deadlock. Threads that are not
+// workers share one extra deque.
+class TaskPool {
+
+	public:
+		// threads counts the calling thread, which helps while it waits, so
+		// threads - 1 workers are started. TaskPool(1) runs everything inline.
+		explicit TaskPool(size_t threads = thread::hardware_concurrency());
+		~TaskPool();
+
+		TaskPool(const TaskPool &other) = delete;
+		TaskPool &operator=(const TaskPool &other) = delete;
+
+		template <class Left, class Right>
+		void Invoke(Left &&left, Right &&right);
+
+		size_t ThreadCount() const { return workers.size() + 1; };
+
+	private:
+		struct Task {
+			void (*call)(void *);
+			void *arg;
+			exception_ptr error;
+			atomic<bool> done{false};
+		};
+
+		struct Queue {
+			mutex lock;
+			deque<Task *> tasks;
+		};
+
+		vector<unique_ptr<Queue>> queues;   // one per worker, then the shared one
+		vector<thread> workers;
+		atomic<size_t> pending{0};
+		mutex sleepLock;
+		condition_variable wake;
+		bool stopping = false;
+
+		inline static thread_local const TaskPool *workerPool = nullptr;
+		inline static thread_local size_t workerIndex = 0;
+
+		size_t OwnQueue() const { return (workerPool == this) ? workerIndex : workers.size(); };
+		void Push(Task *task);
+		Task *Pop(size_t self);
+		static void Run(Task *task);
+		void Wait(Task *task);
+		void WorkerLoop(size_t index);
+};
+
+
+// Constructor
+// Starts threads - 1 workers.
+inline TaskPool::TaskPool(size_t threads) {
+	size_t count = (threads > 1) ? threads - 1 : 0;
+	for (size_t i = 0; i <= count; i++) {
+		queues.push_back(make_unique<Queue>());
+	}
+	workers.reserve(count);
+	for (size_t i = 0; i < count; i++) {
+		workers.emplace_back(&TaskPool::WorkerLoop, this, i);
+	}
+}
+
+// Destructor
+// Lets the workers drain what is queued and joins them.
+inline TaskPool::~TaskPool() {
+	{
+		lock_guard<mutex> guard(sleepLock);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (thread &worker : workers) {
+		worker.join();
+	}
+}
+
+// Invoke
+// Runs left and right, possibly in parallel, and returns once both are done.
+// right is offered to the other threads while this one runs left. If either
+// throws, the exception is rethrown here after both have finished.
+template <class Left, class Right>
+void TaskPool::Invoke(Left &&left, Right &&right) {
+	if (workers.empty()) {
+		left();
+		right();
+		return;
+	}
+
+	Task task;
+	task.call = [](void *arg) { (*static_cast<remove_reference_t<Right> *>(arg))(); };
+	task.arg = const_cast<void *>(static_cast<const void *>(&right));
+	Push(&task);
+
+	exception_ptr leftError;
+	try {
+		left();
+	} catch (...) {
+		leftError = current_exception();
+	}
+	Wait(&task);
+	if (leftError) rethrow_exception(leftError);
+	if (task.error) rethrow_exception(task.error);
+}
+
+// Push
+// Queues a task on the calling thread's deque and wakes a sleeping worker.
+// pending is raised first so it never drops below the number queued.
+inline void TaskPool::Push(Task *task) {
+	{
+		lock_guard<mutex> guard(sleepLock);
+		pending++;
+	}
+	Queue &queue = *queues[OwnQueue()];
+	{
+		lock_guard<mutex> guard(queue.lock);
+		queue.tasks.push_back(task);
+	}
+	wake.notify_one();
+}
+
+// Pop
+// Takes the newest task from deque self, or else steals the oldest task of
+// another deque. Returns nullptr if there is nothing to run.
+inline TaskPool::Task *TaskPool::Pop(size_t self) {
+	for (size_t i = 0; i < queues.size(); i++) {
+		Queue &queue = *queues[(self + i) % queues.size()];
+		lock_guard<mutex> guard(queue.lock);
+		if (!queue.tasks.empty()) {
+			Task *task;
+			if (i == 0) {
+				task = queue.tasks.back();
+				queue.tasks.pop_back();
+			} else {
+				task = queue.tasks.front();
+				queue.tasks.pop_front();
+			}
+			pending--;
+			return task;
+		}
+	}
+	return nullptr;
+}
+
+// Run
+// Runs a task and publishes its completion. The task may be freed by its
+// owner as soon as done is set, so nothing touches it afterwards.
+inline void TaskPool::Run(Task *task) {
+	try {
+		task->call(task->arg);
+	} catch (...) {
+		task->error = current_exception();
+	}
+	task->done.store(true, memory_order_release);
+}
+
+// Wait
+// Runs other queued tasks until task has finished.
+inline void TaskPool::Wait(Task *task) {
+	while (!task->done.load(memory_order_acquire)) {
+		Task *other = Pop(OwnQueue());
+		if (other != nullptr) {
+			Run(other);
+		} else {
+			this_thread::yield();
+		}
+	}
+}
+
+// WorkerLoop
+// Runs or steals tasks, sleeping while nothing is queued.
+inline void TaskPool::WorkerLoop(size_t index) {
+	workerPool = this;
+	workerIndex = index;
+	while (true) {
+		Task *task = Pop(index);
+		if (task != nullptr) {
+			Run(task);
+			continue;
+		}
+		unique_lock<mutex> guard(sleepLock);
+		wake.wait(guard, [this] { return stopping || pending.load() > 0; });
+		if (stopping && pending.load() == 0) return;
+	}
+}
+
+#endif
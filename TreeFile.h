@@ -0,0 +1,93 @@
+#ifndef TREEFILE_H
+#define TREEFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+using namespace std;
+
+
+// RBTFileHeader
+// Start of the binary file written by BasicRedBlackTree::Save. The header is
+// followed by the count keys in order and, for maps, by the count values in
+// the same order, each section starting on a SECTION_ALIGN boundary.
+// No shape or color bits are stored: Load rebuilds with BuildSorted, whose
+// shape depends on nothing but count, so the keys alone describe the tree,
+// and a MappedRedBlackTree can search them straight out of the file.
+// Keys and values are stored in native byte order and size, so a file is
+// meant to be read back by the same build, not exchanged between machines.
+struct RBTFileHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t keySize;
+	uint32_t valueSize;   // 0 for set-style trees and other empty values
+	uint32_t reserved;
+	uint64_t count;
+};
+
+
+// TreeFileLayout
+// Where each section of a tree file holding Key and Value lives, and the
+// header check shared by Load and the mapped tree.
+template <class Key, class Value>
+struct TreeFileLayout {
+	static_assert(is_trivially_copyable<Key>::value, "Tree files need trivially copyable keys");
+	static_assert(is_trivially_copyable<Value>::value, "Tree files need trivially copyable values");
+
+	static constexpr char MAGIC[8] = {'R', 'B', 'T', 'R', 'E', 'E', '\0', '\0'};
+	static constexpr uint32_t VERSION = 1;
+	static constexpr size_t SECTION_ALIGN = 16;
+	static constexpr bool HAS_VALUES = !is_empty<Value>::value;   // NoValue takes no space
+	static constexpr uint32_t VALUE_SIZE = HAS_VALUES ? sizeof(Value) : 0;
+
+	static_assert(alignof(Key) <= SECTION_ALIGN && alignof(Value) <= SECTION_ALIGN, "Over-aligned tree file types");
+
+	static size_t Aligned(size_t offset) { return (offset + SECTION_ALIGN - 1) / SECTION_ALIGN * SECTION_ALIGN; };
+	static size_t KeysOffset() { return Aligned(sizeof(RBTFileHeader)); };
+	static size_t ValuesOffset(uint64_t count) { return Aligned(KeysOffset() + count * sizeof(Key)); };
+	static size_t FileSize(uint64_t count) {
+		return HAS_VALUES ? ValuesOffset(count) + count * sizeof(Value) : KeysOffset() + count * sizeof(Key);
+	};
+
+	static RBTFileHeader Header(uint64_t count);
+	static void Check(const RBTFileHeader &header, size_t fileSize);
+};
+
+
+// Header
+// Returns the header for a file of count entries.
+template <class Key, class Value>
+RBTFileHeader TreeFileLayout<Key, Value>::Header(uint64_t count) {
+	RBTFileHeader header;
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.keySize = sizeof(Key);
+	header.valueSize = VALUE_SIZE;
+	header.reserved = 0;
+	header.count = count;
+	return header;
+}
+
+// Check
+// Throws invalid_argument unless header describes a tree file of this Key
+// and Value that fits in fileSize bytes.
+template <class Key, class Value>
+void TreeFileLayout<Key, Value>::Check(const RBTFileHeader &header, size_t fileSize) {
+	if (fileSize < sizeof(RBTFileHeader) || memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+		throw invalid_argument("Not a tree file.");
+	}
+	if (header.version != VERSION) {
+		throw invalid_argument("Unsupported tree file version.");
+	}
+	if (header.keySize != sizeof(Key) || header.valueSize != VALUE_SIZE) {
+		throw invalid_argument("Tree file holds different key or value types.");
+	}
+	if (header.count > (fileSize - KeysOffset()) / sizeof(Key) || FileSize(header.count) > fileSize) {
+		throw invalid_argument("Tree file is truncated.");
+	}
+}
+
+#endif